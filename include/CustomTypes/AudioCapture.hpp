@@ -0,0 +1,17 @@
+#pragma once
+
+#include <functional>
+#include <span>
+
+#include "UnityEngine/MonoBehaviour.hpp"
+#include "custom-types/shared/macros.hpp"
+
+DECLARE_CLASS_CODEGEN(Replay, AudioCapture, UnityEngine::MonoBehaviour) {
+    DECLARE_DEFAULT_CTOR();
+
+    DECLARE_INSTANCE_METHOD(void, OnAudioFilterRead, ArrayW<float> data, int audioChannels);
+
+   public:
+    // called on the audio thread with blocks of interleaved 16 bit samples
+    std::function<void(std::span<int16_t const>, int)> sink;
+};
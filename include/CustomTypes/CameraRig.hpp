@@ -16,6 +16,7 @@ DECLARE_CLASS_CODEGEN(Replay, CameraRig, UnityEngine::MonoBehaviour) {
     DECLARE_INSTANCE_FIELD(UnityEngine::SpatialTracking::TrackedPoseDriver*, cameraTracker);
     DECLARE_INSTANCE_FIELD(bool, tracking);
     DECLARE_INSTANCE_FIELD(BeatSaber::BeatAvatarSDK::BeatAvatarPoseController*, avatar);
+    DECLARE_INSTANCE_FIELD(ArrayW<BeatSaber::BeatAvatarSDK::BeatAvatarPoseController*>, ghosts);
     DECLARE_INSTANCE_FIELD(UnityEngine::GameObject*, progress);
     DECLARE_INSTANCE_FIELD(TMPro::TextMeshProUGUI*, progressText);
 
@@ -39,6 +39,7 @@ DECLARE_CLASS_CODEGEN(Replay, MenuView, HMUI::ViewController) {
     UnityEngine::UI::Button* watchButton;
     UnityEngine::UI::Button* renderButton;
     UnityEngine::UI::Button* queueButton;
+    UnityEngine::UI::Button* highlightsButton;
     UnityEngine::UI::Button* deleteButton;
     BSML::DropdownListSetting* cameraDropdown;
     BSML::IncrementSetting* increment;
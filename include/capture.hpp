@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "main.hpp"
+
+namespace Capture {
+    struct Stats {
+        size_t bytes = 0;
+        size_t writes = 0;
+        // times a push had to wait for the writer to free space
+        size_t stalls = 0;
+        double stallSeconds = 0;
+        size_t maxQueued = 0;
+    };
+
+    // writes data pushed from a single capture thread to a file on a dedicated thread, through a lock-free ring buffer
+    class Writer {
+       public:
+        static constexpr size_t WriteBlock = 1 << 20;
+
+        explicit Writer(size_t capacity);
+        ~Writer();
+
+        bool Open(std::string const& path, bool append = false);
+        // copies into the ring and returns, only waiting if the file has fallen a whole buffer behind
+        void Push(void const* data, size_t size);
+        // waits for pushes in progress, writes everything still queued and closes the file, then calls onClosed
+        void Close();
+
+        bool IsOpen() const { return open; }
+        Stats const& GetStats() const { return stats; }
+
+        // called once by the next close, even if the file failed to open, so waiting on it can't hang
+        std::function<void()> onClosed;
+
+       private:
+        // ends a push, waking a close waiting for it
+        void Finish();
+        void Work();
+
+        std::unique_ptr<uint8_t[]> buffer;
+        size_t capacity;
+        // total bytes pushed and written, wrapped into the buffer by the capacity
+        std::atomic<size_t> head = 0;
+        std::atomic<size_t> tail = 0;
+        std::atomic<bool> open = false;
+        std::atomic<bool> closing = false;
+        // pushes that passed the open check, so closing and reopening can't reset the ring under them
+        std::atomic<int> pushing = 0;
+        std::mutex mutex;
+        std::condition_variable condition;
+
+        std::string path;
+        int file = -1;
+        std::thread thread;
+        Stats stats;
+    };
+
+    // calls a function once every stream of a capture has signaled that it's complete
+    class Completion {
+       public:
+        void Reset(int streams, std::function<void()> done);
+        void Signal();
+
+       private:
+        std::mutex mutex;
+        int remaining = 0;
+        std::function<void()> done;
+    };
+
+    void WriteWavHeader(Writer& writer, int sampleRate, int channels);
+    // fills in the sizes in the header once the file is closed
+    void FinishWav(std::string const& path);
+
+    // runs slow work after a capture, like muxing, on a background thread in submission order,
+    // calling finished on that thread once the job is no longer counted as pending
+    void SubmitJob(std::function<void()> job, std::function<void()> finished = nullptr);
+    // jobs submitted but not yet finished, including the one running
+    int PendingJobs();
+}
@@ -21,6 +21,11 @@ DECLARE_JSON_STRUCT(ButtonPair) {
     VALUE(int, BackController);
 };
 
+DECLARE_JSON_STRUCT(TimeRange) {
+    VALUE(float, Start);
+    VALUE(float, End);
+};
+
 DECLARE_JSON_STRUCT(LevelSelection) {
     VALUE(std::string, ID);
     VALUE(int, Difficulty);
@@ -28,6 +33,8 @@ DECLARE_JSON_STRUCT(LevelSelection) {
     VALUE(std::string, ReplayDesc);
     VALUE(std::string, ReplayHash);
     VALUE(bool, Temporary);
+    // song times to render, or the whole song if empty
+    VALUE_DEFAULT(std::vector<TimeRange>, Ranges, {});
 };
 
 DECLARE_JSON_STRUCT(ThirdPerPreset) {
@@ -38,6 +45,7 @@ DECLARE_JSON_STRUCT(ThirdPerPreset) {
 DECLARE_CONFIG(Config) {
     CONFIG_VALUE(Version, int, "Config Version", 2);
     CONFIG_VALUE(CamMode, int, "Camera Mode", 0);
+    // only read to move an old queue into the queue journal
     CONFIG_VALUE(RenderQueue, std::vector<LevelSelection>, "Render Queue", {});
     CONFIG_VALUE(LastReplayHash, std::string, "Last Selected Replay Hash", "");
     CONFIG_VALUE(OverrideWidth, int, "Override Resolution Width", -1);
@@ -50,6 +58,7 @@ DECLARE_CONFIG(Config) {
     CONFIG_VALUE(HideText, bool, "Hide Player Text", true, "Whether to hide the REPLAY player text for your own replays");
     CONFIG_VALUE(TextHeight, float, "Player Text Height", 3.5, "The height of the REPLAY player text when visible");
     CONFIG_VALUE(Avatar, bool, "Enable Avatar", true, "Shows avatar when in third person camera mode");
+    CONFIG_VALUE(Ghosts, bool, "Show Other Replays", false, "Shows the other local replays of the map as extra avatars in third person mode");
 
     CONFIG_VALUE(Walls, int, "Wall Style", 0, "What kind of walls to display when rendering");
     CONFIG_VALUE(Bloom, bool, "Bloom", true, "Whether to use PC bloom when rendering");
@@ -68,9 +77,30 @@ DECLARE_CONFIG(Config) {
         true,
         "Whether to use the HEVC/H265 encoder, instead of AVC/H264, for better video quality but potentially less support on old devices or platforms"
     );
+    CONFIG_VALUE(
+        LegacyMux,
+        bool,
+        "Mux After Rendering",
+        false,
+        "Writes separate video and audio files and combines them after the render, instead of building the mp4 while rendering"
+    );
 
     CONFIG_VALUE(Pauses, bool, "Allow Pauses", false, "Whether to allow the game to pause while rendering");
     CONFIG_VALUE(Ding, bool, "Ding", false, "Plays a sound when renders are finished");
+    CONFIG_VALUE(
+        GroupQueue,
+        bool,
+        "Group Queue",
+        false,
+        "Reorders the render queue so replays of the same level and difficulty render back to back"
+    );
+    CONFIG_VALUE(
+        ResamplePoses,
+        bool,
+        "Resample Movements",
+        false,
+        "Resamples the recorded movements to the render FPS before rendering, for consistent frame times"
+    );
 
     CONFIG_VALUE(TimeButton, ButtonPair, "Skip Forward|Skip Backward", {}, "Skips around in the time while watching a replay");
     CONFIG_VALUE(TimeSkip, int, "Time Skip Amount", 5, "Number of seconds to skip per button press");
@@ -93,3 +123,29 @@ DECLARE_CONFIG(Config) {
     );
     CONFIG_VALUE(CleanFiles, bool, "Remove Temp Files", true);
 };
+
+// plain copies of the config values used every frame during replays, so hot paths don't look up or copy config values
+// taken when a replay starts and updated when the values change
+struct ReplayConfig {
+    CameraMode mode;
+    float smoothing;
+    bool correction;
+    float targetTilt;
+    UnityEngine::Vector3 offset;
+    int fps;
+    bool avatar;
+    Button moveButton;
+    ButtonPair travelButton;
+    float travelSpeed;
+    ButtonPair timeButton;
+    int timeSkip;
+    ButtonPair speedButton;
+    int walls;
+    bool bloom;
+    // zero if disabled
+    int shockwaves;
+    bool pauses;
+    // entries left in the render queue, and how many of the next ones are the current level if grouping
+    int queued;
+    int queuedOfLevel;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <span>
+
+#include "main.hpp"
+
+namespace Flac {
+    // encodes 16 bit pcm into flac frames using fixed predictors and rice coded residuals
+    class Encoder {
+       public:
+        static constexpr int BlockSize = 4096;
+
+        Encoder(int sampleRate, int channels);
+
+        // the 34 byte streaminfo metadata block body
+        std::vector<uint8_t> StreamInfo() const;
+        // appends one frame of up to a block of interleaved samples, only the last frame of the stream can be shorter
+        void EncodeFrame(std::span<int16_t const> samples, uint32_t frameNumber, std::vector<uint8_t>& out);
+
+       private:
+        int sampleRate;
+        int channels;
+        // one deinterleaved channel plus the mid and side channels for stereo
+        std::array<std::vector<int32_t>, 8> signals;
+        std::vector<int32_t> residual;
+    };
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "replay.hpp"
+
+namespace Highlights {
+    enum struct Kind { Stream, Accuracy, Recovery, Misses };
+
+    struct Clip {
+        float start;
+        float end;
+        float score;
+        Kind kind;
+    };
+
+    // scores windows of the replay in one pass over its events, returning up to count clips without overlaps, best first
+    std::vector<Clip> Find(Replay::Events::Data const& events, float songLength, int count);
+
+    std::string_view GetKindName(Kind kind);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "config.hpp"
+#include "mp4.hpp"
+
+namespace Journal {
+    // a render that was interrupted, with the checkpoints that made it to the file
+    struct Render {
+        std::string settings;
+        LevelSelection level;
+        std::vector<Mp4::Checkpoint> checkpoints;
+        // quit instead of interrupted by a crash, so it isn't put back in the queue on launch
+        bool quit = false;
+    };
+
+    // checkpoints are recorded at most this often, in seconds of video
+    static constexpr float SegmentSeconds = 10;
+
+    void Start(std::string const& settings, LevelSelection const& level);
+    // called on the encoder thread for each fragment
+    void Record(Mp4::Checkpoint const& checkpoint);
+    void MarkQuit();
+    std::optional<Render> Load();
+    void Clear();
+}
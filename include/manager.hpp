@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GlobalNamespace/BeatmapKey.hpp"
+#include "config.hpp"
 #include "replay.hpp"
 
 namespace Manager {
@@ -9,7 +10,7 @@ namespace Manager {
     void SelectLevelInConfig(int index);
     void BeginQueue();
 
-    void SaveCurrentLevelInConfig();
+    void SaveCurrentLevelInConfig(std::vector<TimeRange> ranges = {});
     void RemoveCurrentLevelFromConfig();
     bool IsCurrentLevelInConfig();
     void ClearLevelsFromConfig();
@@ -22,8 +23,16 @@ namespace Manager {
 
     void StartReplay(bool render);
     void CameraFinished();
+    // puts a quit render back at the front of the queue, if it was taken from the queue
+    void RequeueRender();
+    // the parts of the song to render for the current queue entry, empty for all of it
+    std::vector<TimeRange> const& GetRenderRanges();
+    // the current render as a queue entry, to resume it if it's interrupted
+    LevelSelection GetRenderSelection();
 
     Replay::Data& GetCurrentReplay();
+    // for work that can outlive the current selection
+    std::shared_ptr<Replay::Data> GetCurrentReplayShared();
     Replay::Info& GetCurrentInfo();
     void DeleteCurrentReplay();
 
@@ -33,4 +42,8 @@ namespace Manager {
 
     bool HasRotations();
     bool CancelPresentation();
+
+    // keeps the replay config up to date with changes from then on
+    void WatchConfig();
+    ReplayConfig const& GetReplayConfig();
 }
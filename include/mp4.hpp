@@ -0,0 +1,90 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <span>
+
+#include "capture.hpp"
+#include "flac.hpp"
+
+namespace Mp4 {
+    // the state after a fragment, enough to continue the file from there
+    struct Checkpoint {
+        size_t offset;
+        uint32_t sequence;
+        uint64_t videoTime;
+        uint64_t audioTime;
+        // seconds of video
+        float time;
+    };
+
+    // builds a fragmented mp4 from annex b video units and 16 bit pcm audio as they are captured,
+    // so the file is complete as soon as capture ends without a separate muxing pass
+    // audio is stored losslessly as flac, encoded on its own thread and added to the next fragment
+    class Muxer {
+       public:
+        ~Muxer();
+
+        // fragments are cut at the first keyframe after this long, or regardless after four times it
+        static constexpr float FragmentSeconds = 1;
+
+        bool Open(std::string const& path, int width, int height, int fps, bool hevc, int sampleRate, int channels);
+        // truncates a file written with the same settings back to a checkpoint and appends to it
+        bool Resume(std::string const& path, int width, int height, int fps, bool hevc, int sampleRate, int channels, Checkpoint const& checkpoint);
+        // called on the encoder thread with one access unit or codec config buffer
+        void AddVideo(uint8_t const* data, size_t size);
+        // called on the audio thread with interleaved samples
+        void AddAudio(std::span<int16_t const> samples, int channels);
+        // writes the remaining samples and closes the file
+        void Finish();
+
+        bool IsOpen() const { return output.IsOpen(); }
+
+        // called on the encoder thread after each fragment is queued for writing
+        std::function<void(Checkpoint const&)> onFragment;
+
+       private:
+        void WriteHeader();
+        void WriteFragment();
+        void StartAudio();
+        // encodes everything still pending and stops the audio thread
+        void StopAudio();
+        void EncodeAudio(uint32_t frame);
+        void Reset(int width, int height, int fps, bool hevc, int sampleRate, int channels);
+        void Output(void const* data, size_t size);
+
+        Capture::Writer output{32 << 20};
+        std::mutex mutex;
+        // only guards the pending pcm, so the audio thread never waits on encoding
+        std::mutex audioMutex;
+        std::condition_variable audioCondition;
+        std::thread audioThread;
+        bool audioStopping = false;
+
+        int width = 0;
+        int height = 0;
+        int fps = 0;
+        bool hevc = false;
+        int sampleRate = 0;
+        int channels = 0;
+        bool wroteHeader = false;
+        std::vector<std::vector<uint8_t>> parameterSets;
+
+        size_t offset = 0;
+        uint32_t sequence = 0;
+        uint64_t videoTime = 0;
+        uint64_t audioTime = 0;
+
+        // pending samples for the next fragment, reused between fragments
+        std::vector<uint8_t> videoData;
+        std::vector<uint32_t> videoSizes;
+        std::vector<bool> videoSync;
+        std::vector<int16_t> audioData;
+        // encoded frames waiting for the next fragment, added under the main mutex
+        std::vector<uint8_t> audioFrames;
+        std::vector<uint32_t> audioSizes;
+        std::vector<uint32_t> audioDurations;
+        std::optional<Flac::Encoder> flac;
+        std::vector<uint8_t> box;
+    };
+}
@@ -14,6 +14,8 @@ namespace Parsing {
     std::shared_ptr<Replay::Data> ReadReqlay(std::string const& path);
     std::shared_ptr<Replay::Data> ReadScoresaber(std::string const& path);
     std::shared_ptr<Replay::Data> ReadBSOR(std::string const& path);
+    // for files owned by other mods, which can be removed during playback, so nothing is streamed from them
+    std::shared_ptr<Replay::Data> ReadTemporaryBSOR(std::string const& path);
 
     std::string GetFullHash(std::istream& input);
 
@@ -22,11 +24,26 @@ namespace Parsing {
 
     void CheckErrorState(std::istream& input, std::string hint = "unspecified");
 
+    struct ReplayFile {
+        std::string path;
+        std::string type;
+        std::shared_ptr<Replay::Data> (*read)(std::string const& path);
+    };
+
+    // finding replays needs the main thread, but reading them doesn't
+    std::vector<ReplayFile> FindReplays(GlobalNamespace::BeatmapKey beatmap);
+    std::vector<std::pair<std::string, std::shared_ptr<Replay::Data>>> ReadReplays(std::vector<ReplayFile> const& files);
     std::vector<std::pair<std::string, std::shared_ptr<Replay::Data>>> GetReplays(GlobalNamespace::BeatmapKey beatmap);
 
     void PreProcess(Replay::Data& replay);
     void CheckForQuit(Replay::Info& info, float songLength);
-    void RecalculateNotes(Replay::Data& replay, GlobalNamespace::IReadonlyBeatmapData* beatmapData);
+    void PrepareRecalculation(
+        std::shared_ptr<Replay::Data> replay, GlobalNamespace::BeatmapKey beatmap, GlobalNamespace::IReadonlyBeatmapData* beatmapData
+    );
+    // saved recalculations past this size are removed, least recently used first
+    static constexpr size_t MaxRecalculationsSize = 16 << 20;
+    void PruneRecalculations();
+    void RecalculateNotes(Replay::Data& replay, GlobalNamespace::BeatmapKey beatmap, GlobalNamespace::IReadonlyBeatmapData* beatmapData);
 }
 
 #define READ_TO(name)                                                   \
@@ -2,11 +2,14 @@
 
 #include "GlobalNamespace/ScoreMultiplierUIController.hpp"
 #include "main.hpp"
+#include "replay.hpp"
 
 namespace Pause {
     void OnPause();
     void OnUnpause();
 
+    void CreateCheckpoints(Replay::Data& replay);
+
     bool AllowAnimation(GlobalNamespace::ScoreMultiplierUIController* multiplier);
 
     void SetSpeed(float value);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "config.hpp"
+
+namespace Persist {
+    // seconds without changes before pending values are saved
+    static constexpr float SaveDelay = 2;
+
+    // queues a save, replacing any already queued for the same key
+    void MarkDirty(void const* key, std::function<void()> save);
+    // saves everything pending, called at safe points like pausing or leaving a map
+    // runs on the main thread, since config-utils serializes the live config document when saving
+    void Flush();
+    // called every frame, to save once changes have stopped
+    void Update();
+
+    // writes to a temporary file and renames it over the path, so a crash never leaves a partial file
+    bool WriteFile(std::string const& path, std::string_view data);
+
+    // for values that can change every frame, which would otherwise rewrite the whole config each time
+    template <class T>
+    void Set(ConfigUtils::ConfigValue<T>& value, std::type_identity_t<T> const& newValue) {
+        value.SetValue(newValue, false);
+        MarkDirty(&value, [&value]() { value.SetValue(value.GetValue()); });
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GlobalNamespace/GameEnergyCounter.hpp"
+#include "GlobalNamespace/IReadonlyBeatmapData.hpp"
 #include "GlobalNamespace/NoteController.hpp"
 #include "GlobalNamespace/PlayerSpecificSettings.hpp"
 #include "GlobalNamespace/PracticeSettings.hpp"
@@ -14,10 +15,17 @@ namespace Playback {
     void SeekTo(float time);
 
     Replay::Pose const& GetPose();
+    // doesn't use any playback state, so it can be called from other threads while the replay is kept alive
+    void SamplePoses(Replay::Data const& replay, float rate, std::function<void(Replay::Pose const&)> const& callback);
+
+    void SetGhosts(std::vector<std::shared_ptr<Replay::Data>> ghosts);
+    int GetGhostCount();
+    Replay::Pose const& GetGhostPose(int ghost);
 
     bool DisableRealEvent(bool bad);
     bool DisableListSorting();
 
+    void BindNotes(GlobalNamespace::IReadonlyBeatmapData* beatmapData);
     void AddNoteController(GlobalNamespace::NoteController* note);
     void RemoveNoteController(GlobalNamespace::NoteController* note);
 
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "replay.hpp"
+
+namespace Replay {
+    // reads poses from the replay file during playback, keeping only the chunks around the current position in memory
+    class PoseStream {
+       public:
+        using Chunk = std::shared_ptr<std::vector<Pose> const>;
+
+        static constexpr int ChunkPoses = 2048;
+        // about five minutes at 90 fps
+        static constexpr int MinPoses = 27000;
+
+        PoseStream(std::string path, std::streamoff offset, std::vector<Pose> const& poses);
+        ~PoseStream();
+
+        int size() const { return count; }
+        Pose const& front() const { return keyframes.front(); }
+        Pose const& back() const { return last; }
+
+        // reads the chunk on the calling thread if it hasn't been prefetched
+        Pose operator[](int index);
+        bool IsResident(int index);
+
+        // the first pose of the chunk containing the time, found without reading the file
+        int ChunkStart(float time) const;
+        Pose const& Keyframe(float time) const;
+
+        // reads the poses in order on its own, without changing the playback window, so it can be used on any thread
+        class Reader {
+           public:
+            explicit Reader(std::shared_ptr<PoseStream const> stream) : stream(std::move(stream)) {}
+
+            int size() const { return stream->size(); }
+            Pose const& front() const { return stream->front(); }
+            Pose const& back() const { return stream->back(); }
+            Pose operator[](int index);
+
+           private:
+            std::shared_ptr<PoseStream const> stream;
+            std::ifstream input;
+            int currentIndex = -1;
+            Chunk current;
+        };
+
+        // reads every pose at once, for when the file can't be kept
+        std::vector<Pose> ReadAll() const;
+
+        // moves the resident window to the chunk containing the pose and loads it and the next one in the background
+        void Prefetch(int index);
+
+       private:
+
+        Chunk Read(int chunk, std::ifstream& input) const;
+        void Work();
+
+        std::string path;
+        std::streamoff offset;
+        int count;
+        std::vector<Pose> keyframes;
+        Pose last;
+
+        // only used by the playback thread
+        std::ifstream input;
+        int currentIndex = -1;
+        Chunk current;
+        // kept when moving forward a chunk, so interpolating across the boundary doesn't switch back and forth
+        int previousIndex = -1;
+        Chunk previous;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::map<int, Chunk> chunks;
+        std::set<int> requested;
+        int window = 0;
+        bool stop = false;
+        std::thread thread;
+    };
+}
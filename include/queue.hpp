@@ -0,0 +1,20 @@
+#pragma once
+
+#include "config.hpp"
+
+// the render queue, kept in memory and stored as a journal of changes instead of in the config,
+// so each change appends one line instead of rewriting the whole config
+namespace Queue {
+    // reads the journal, moving a queue saved in the config into it the first time
+    void Load();
+
+    std::vector<LevelSelection> const& Get();
+    bool Empty();
+    bool Contains(LevelSelection const& level);
+
+    void Add(LevelSelection const& level);
+    void Remove(int index);
+    void Clear();
+    // rewrites the journal with a new order or set of entries
+    void Replace(std::vector<LevelSelection> levels);
+}
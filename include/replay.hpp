@@ -10,6 +10,12 @@ namespace Replay {
     };
 
     namespace Frames {
+        // precalculated per frame during preprocessing
+        enum Flags : uint8_t {
+            ComboDropAllowed = 1 << 0,
+            HasPercent = 1 << 1,
+        };
+
         struct Score {
             float time = 0;
             int score = -1;
@@ -20,6 +26,7 @@ namespace Replay {
             int multiplier = 1;
             int multiplierProgress = 0;
             int maxCombo = 0;
+            uint8_t flags = 0;
 
             constexpr Score() = default;
             constexpr Score(float time, int score, float percent, int combo, float energy, float offset, int multiplier, int multiplierProgress) :
@@ -79,7 +86,9 @@ namespace Replay {
             short obstacleType;
             short width;
             float time;
-            float endTime;
+            float endTime = -1;
+            // recorded instead of the end time by some versions, which is then reconstructed in preprocessing
+            float endEnergy = -1;
         };
 
         struct Height {
@@ -105,7 +114,6 @@ namespace Replay {
             int maxCombo;
             int maxLeftCombo;
             int maxRightCombo;
-            float energy;
             int multiplier;
             int multiplierProgress;
 
@@ -122,12 +130,33 @@ namespace Replay {
             };
         };
 
+        // energy is linear between points, with notes adding a second point at the same time
+        struct EnergyPoint {
+            float time;
+            float energy;
+            // total energy lost to walls, without clamping
+            float wallDrain;
+        };
+
+        // precalculated per note, with the same indices as the notes
+        struct Scores {
+            std::vector<uint8_t> pre;
+            // set to full post swing for chain heads, for average calculations
+            std::vector<uint8_t> post;
+            std::vector<uint8_t> acc;
+            std::vector<uint8_t> total;
+            std::vector<uint8_t> max;
+            std::vector<float> energy;
+        };
+
         struct Data {
             std::vector<Note> notes;
+            Scores scores;
             std::vector<Wall> walls;
             std::vector<Height> heights;
             std::vector<Pause> pauses;
             std::set<Reference, Reference::Comparer> events;
+            std::vector<EnergyPoint> energy;
             bool needsRecalculation = false;
             bool cutInfoMissingOKs = false;
             bool hasBombCutInfo = true;
@@ -206,6 +235,8 @@ namespace Replay {
             rightHand(rightHand) {}
     };
 
+    class PoseStream;
+
     struct Offsets {
         Transform leftSaber;
         Transform rightSaber;
@@ -214,6 +245,8 @@ namespace Replay {
     struct Data {
         Info info;
         std::vector<Pose> poses;
+        // replaces poses for long replays that are read during playback
+        std::shared_ptr<PoseStream> poseStream;
         std::optional<Frames::Data> frames;
         std::optional<Events::Data> events;
         std::optional<Offsets> offsets;
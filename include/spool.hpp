@@ -0,0 +1,18 @@
+#pragma once
+
+#include "config.hpp"
+#include "replay.hpp"
+
+// copies of the files that temporary queued replays were read from, by replay hash,
+// so they don't need to stay in memory and can still be rendered after the original is gone or the game restarts
+namespace Spool {
+    // returns false if the file can't be spooled, like when it isn't a bsor
+    bool Add(std::string const& hash, std::string const& path);
+    bool Contains(std::string const& hash);
+    // the path of the copy, or empty if there isn't one
+    std::string GetPath(std::string const& hash);
+    // reads the replay back from its copy, or returns null if it can't
+    std::shared_ptr<Replay::Data> Load(std::string const& hash);
+    // only when nothing is rendering, since bsor movements are streamed from the copy during renders
+    void Prune(std::vector<LevelSelection> const& levels);
+}
@@ -38,9 +38,14 @@ namespace Utils {
     bool IsLeft(Replay::Events::Note const& note, bool hasBombCutInfo);
 
     float EnergyForNote(Replay::Events::NoteInfo const& note, bool oldScoringType);
+    Replay::Events::EnergyPoint SampleEnergy(std::vector<Replay::Events::EnergyPoint> const& curve, float time);
     std::array<int, 4> ScoreForNote(Replay::Events::Note const& note, bool max = false);
 
     int BSORNoteID(Replay::Events::NoteInfo const& note);
+    Replay::Events::NoteInfo GetNoteInfo(GlobalNamespace::NoteData* data);
+    bool Matches(
+        Replay::Events::NoteInfo const& data, Replay::Events::NoteInfo const& info, bool oldScoringTypes = false, bool checkME = false
+    );
     bool Matches(GlobalNamespace::NoteData* data, Replay::Events::NoteInfo const& info, bool oldScoringTypes = false, bool checkME = false);
 
     bool IsButtonDown(Button const& button);
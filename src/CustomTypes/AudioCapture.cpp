@@ -0,0 +1,25 @@
+#include "CustomTypes/AudioCapture.hpp"
+
+#include "main.hpp"
+
+DEFINE_TYPE(Replay, AudioCapture);
+
+using namespace Replay;
+
+static constexpr int ConvertBlock = 1024;
+
+void AudioCapture::OnAudioFilterRead(ArrayW<float> data, int audioChannels) {
+    if (!sink || audioChannels <= 0)
+        return;
+
+    // keep blocks to whole frames so channels stay aligned for the sink
+    int block = ConvertBlock - ConvertBlock % audioChannels;
+    int16_t converted[ConvertBlock];
+    int size = data.size();
+    for (int start = 0; start < size; start += block) {
+        int count = std::min(block, size - start);
+        for (int i = 0; i < count; i++)
+            converted[i] = std::clamp(data[start + i], -1.f, 1.f) * std::numeric_limits<int16_t>::max();
+        sink(std::span<int16_t const>(converted, count), audioChannels);
+    }
+}
@@ -41,9 +41,11 @@ void CameraRig::UpdateProgress() {
     std::string time = MetaCore::Strings::SecondsToString(MetaCore::Stats::GetSongTime());
     std::string total = MetaCore::Strings::SecondsToString(MetaCore::Stats::GetSongLength());
     std::string queue = "";
-    int len = getConfig().RenderQueue.GetValue().size();
-    if (len > 0)
-        queue = fmt::format("\n{} in queue", len);
+    auto& config = Manager::GetReplayConfig();
+    if (config.queued > 0)
+        queue = fmt::format("\n{} in queue", config.queued);
+    if (config.queuedOfLevel > 0)
+        queue += fmt::format(" ({} more of this level)", config.queuedOfLevel);
     std::string label = fmt::format("{}\nRendering...\nSong Time: {} / {}{}", mapString, time, total, queue);
     progressText->text = label;
 }
@@ -85,6 +87,27 @@ UnityEngine::Quaternion CameraRig::GetRotation() {
     return cameraTransform->rotation;
 }
 
+static BeatAvatarPoseController*
+CreateAvatar(GlobalNamespace::BeatAvatarEditorFlowCoordinator* avatarCoordinator, UnityEngine::Transform* parent, std::string name) {
+    auto playerAvatar = avatarCoordinator->_avatarContainerGameObject->transform->GetChild(0)->GetComponent<BeatAvatarPoseController*>();
+    auto customAvatar = UnityEngine::Object::Instantiate(playerAvatar);
+    UnityEngine::GameObject::SetName(customAvatar, name);
+    auto visualController = customAvatar->GetComponent<BeatAvatarVisualController*>();
+
+    auto dataModel = avatarCoordinator->_avatarDataModel;
+    visualController->_avatarPartsModel = dataModel->_avatarPartsModel;
+    visualController->UpdateAvatarVisual(dataModel->avatarData);
+
+    auto transform = customAvatar->transform;
+    // avatar uses the frame data, not the calculations in PlayerTransforms_Update
+    if (Manager::GetCurrentInfo().positionsAreLocal)
+        transform->SetParent(parent);
+    transform->position = {0, 0, 0};
+    transform->localScale = {1, 1, 1};
+
+    return customAvatar;
+}
+
 CameraRig* CameraRig::Create(UnityEngine::Transform* cameraTransform) {
     // original hierarchy:
     // parent
@@ -94,6 +117,7 @@ CameraRig* CameraRig::Create(UnityEngine::Transform* cameraTransform) {
     // parent
     //  - headReplacement (playerTransforms->headTransform)
     //  - customAvatar
+    //  - ghost avatars
     // cameraRig (root object)
     //  - cameraTransform (main camera, TrackedPoseDriver)
     //     - progress
@@ -115,27 +139,17 @@ CameraRig* CameraRig::Create(UnityEngine::Transform* cameraTransform) {
     auto avatarCoordinator = UnityEngine::Resources::FindObjectsOfTypeAll<GlobalNamespace::BeatAvatarEditorFlowCoordinator*>()->First([](auto x) {
         return x->_avatarDataModel != nullptr;
     });
-    auto playerAvatar = avatarCoordinator->_avatarContainerGameObject->transform->GetChild(0)->GetComponent<BeatAvatarPoseController*>();
-    auto customAvatar = UnityEngine::Object::Instantiate(playerAvatar);
-    UnityEngine::GameObject::SetName(customAvatar, "ReplayCustomAvatar");
-    auto visualController = customAvatar->GetComponent<BeatAvatarVisualController*>();
-
-    auto dataModel = avatarCoordinator->_avatarDataModel;
-    visualController->_avatarPartsModel = dataModel->_avatarPartsModel;
-    visualController->UpdateAvatarVisual(dataModel->avatarData);
-
-    auto transform = customAvatar->transform;
-    // avatar uses the frame data, not the calculations in PlayerTransforms_Update
-    if (Manager::GetCurrentInfo().positionsAreLocal)
-        transform->SetParent(parent);
-    transform->position = {0, 0, 0};
-    transform->localScale = {1, 1, 1};
+    cameraRig->avatar = CreateAvatar(avatarCoordinator, parent, "ReplayCustomAvatar");
 
-    cameraRig->avatar = customAvatar;
+    // other replays shown alongside the main one
+    int ghosts = Playback::GetGhostCount();
+    cameraRig->ghosts = ArrayW<BeatAvatarPoseController*>(ghosts);
+    for (int i = 0; i < ghosts; i++)
+        cameraRig->ghosts[i] = CreateAvatar(avatarCoordinator, parent, fmt::format("ReplayGhostAvatar{}", i));
 
     auto progress = BSML::Lite::CreateCanvas();
     progress->name = "RenderProgressScreen";
-    transform = progress->transform;
+    auto transform = progress->transform;
     transform->SetParent(cameraTransform, false);
     transform->localPosition = {0, 0, 2};
     transform->localScale = {0.05, 0.05, 0.05};
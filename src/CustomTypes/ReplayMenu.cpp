@@ -14,6 +14,7 @@
 #include "bsml/shared/Helpers/creation.hpp"
 #include "bsml/shared/Helpers/getters.hpp"
 #include "config.hpp"
+#include "highlights.hpp"
 #include "main.hpp"
 #include "manager.hpp"
 #include "metacore/shared/songs.hpp"
@@ -29,6 +30,8 @@ using namespace UnityEngine;
 
 Replay::MenuView* Replay::MenuView::instance = nullptr;
 
+static constexpr int HighlightClips = 3;
+
 static ConstString RecordingHint = "Install BeatLeader or ScoreSaber to record replays";
 
 GameObject* canvas;
@@ -60,6 +63,27 @@ static void OnQueueButtonClick() {
     Replay::MenuView::GetInstance()->OnEnable();
 }
 
+static void OnHighlightsButtonClick() {
+    auto& replay = Manager::GetCurrentReplay();
+    if (!replay.events)
+        return;
+    auto level = MetaCore::Songs::GetSelectedLevel();
+    float songLength = level ? level->songDuration : std::numeric_limits<float>::infinity();
+
+    std::vector<TimeRange> ranges;
+    for (auto& clip : Highlights::Find(*replay.events, songLength, HighlightClips)) {
+        auto& range = ranges.emplace_back();
+        range.Start = clip.start;
+        range.End = clip.end;
+    }
+    if (ranges.empty())
+        return;
+    // render in song order, since the clips are ranked
+    std::sort(ranges.begin(), ranges.end(), [](TimeRange const& a, TimeRange const& b) { return a.Start < b.Start; });
+    Manager::SaveCurrentLevelInConfig(std::move(ranges));
+    Replay::MenuView::GetInstance()->OnEnable();
+}
+
 static void OnDeleteButtonClick() {
     if (!Manager::AreReplaysLocal())
         return;
@@ -175,6 +199,9 @@ void Replay::MenuView::DidActivate(bool firstActivation, bool addedToHierarchy,
     queueButton = BSML::Lite::CreateUIButton(horizontal4, queueText, Vector2(), {33, 8}, OnQueueButtonClick);
     RemoveFit(queueButton);
 
+    highlightsButton = BSML::Lite::CreateUIButton(horizontal4, "Queue Highlights", Vector2(), {33, 8}, OnHighlightsButtonClick);
+    RemoveFit(highlightsButton);
+
     auto settingsButton = BSML::Lite::CreateUIButton(transform, "", {32, -62}, {10, 10}, OnSettingsButtonClick);
     SetPreferred(settingsButton, -1, std::nullopt);
     auto settigsIcon = BSML::Lite::CreateImage(settingsButton, PNG_SPRITE(Settings));
@@ -241,6 +268,7 @@ void Replay::MenuView::UpdateUI(bool getData) {
     if (beatmapData) {
         float num = info.score * 100.0 / ScoreModel::ComputeMaxMultipliedScoreForBeatmap(beatmapData);
         percent = fmt::format("{:.2f}", num);
+        Parsing::PrepareRecalculation(Manager::GetCurrentReplayShared(), beatmap, beatmapData);
     }
     std::string score = fmt::format("{} <size=80%>(<color=#1dbcd1>{}%</color>)</size>", info.score, percent);
     std::string status = Utils::GetStatusString(info, true, songLength);
@@ -251,6 +279,7 @@ void Replay::MenuView::UpdateUI(bool getData) {
     statusText->text = GetLayeredText("Status", status);
 
     BSML::Lite::SetButtonText(queueButton, QueueButtonText());
+    highlightsButton->interactable = Manager::GetCurrentReplay().events.has_value();
 
     deleteButton->gameObject->SetActive(Manager::AreReplaysLocal());
 
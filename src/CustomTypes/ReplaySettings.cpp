@@ -24,6 +24,7 @@
 #include "metacore/shared/songs.hpp"
 #include "metacore/shared/ui.hpp"
 #include "metacore/shared/unity.hpp"
+#include "queue.hpp"
 #include "utils.hpp"
 
 DEFINE_TYPE(Replay, MainSettings)
@@ -207,6 +208,8 @@ void MainSettings::DidActivate(bool firstActivation, bool addedToHierarchy, bool
     AddConfigValueIncrementFloat(transform, getConfig().TextHeight, 1, 0.1, 1, 5);
 
     AddConfigValueToggle(transform, getConfig().Avatar);
+
+    AddConfigValueToggle(transform, getConfig().Ghosts);
 }
 
 MainSettings* MainSettings::GetInstance() {
@@ -258,8 +261,14 @@ void RenderSettings::DidActivate(bool firstActivation, bool addedToHierarchy, bo
 
     AddConfigValueToggle(rendering, getConfig().Ding);
 
+    AddConfigValueToggle(rendering, getConfig().GroupQueue);
+
+    AddConfigValueToggle(rendering, getConfig().ResamplePoses);
+
     AddConfigValueToggle(rendering, getConfig().HEVC);
 
+    AddConfigValueToggle(rendering, getConfig().LegacyMux);
+
     auto horizontal = BSML::Lite::CreateHorizontalLayoutGroup(rendering);
 
     beginQueueButton = CreateSmallButton(horizontal, "Begin Queue", [this]() {
@@ -305,7 +314,7 @@ void RenderSettings::GetCover(BeatmapLevel* level) {
 void RenderSettings::UpdateCover(BeatmapLevel* level, UnityEngine::Sprite* cover) {
     if (!queueList || !enabled)
         return;
-    auto levels = getConfig().RenderQueue.GetValue();
+    auto const& levels = Queue::Get();
     for (int i = 0; i < levels.size(); i++) {
         if (levels[i].ID == level->levelID)
             queueList->data[i]->icon = cover;
@@ -325,12 +334,14 @@ static void AddCoverlessCell(BSML::CustomListTableData* list, LevelSelection con
         mapper = fmt::format(" [{}]", beatmap->allMappers->First());
     if (!level.ReplayDesc.empty())
         desc = fmt::format(" - {}", level.ReplayDesc);
+    if (!level.Ranges.empty())
+        desc += fmt::format(" ({} {})", level.Ranges.size(), level.Ranges.size() == 1 ? "clip" : "clips");
     std::string subtext = fmt::format("{}{}{}", author, mapper, desc);
     list->data->Add(BSML::CustomCellInfo::construct(toptext, subtext, nullptr));
 }
 
 void RenderSettings::OnEnable() {
-    auto levels = getConfig().RenderQueue.GetValue();
+    auto const& levels = Queue::Get();
     bool empty = levels.empty();
     if (beginQueueButton)
         beginQueueButton->interactable = !empty;
@@ -11,7 +11,7 @@
 
 EXPOSE_API(PlayBSORFromFile, bool, std::string path) {
     try {
-        auto replay = Parsing::ReadBSOR(path);
+        auto replay = Parsing::ReadTemporaryBSOR(path);
         Manager::SetExternalReplay(path, replay);
 
         Replay::MenuView::Present();
@@ -24,7 +24,7 @@ EXPOSE_API(PlayBSORFromFile, bool, std::string path) {
 
 EXPOSE_API(PlayBSORFromFileForced, bool, std::string path) {
     try {
-        auto replay = Parsing::ReadBSOR(path);
+        auto replay = Parsing::ReadTemporaryBSOR(path);
         Manager::SetExternalReplay(path, replay);
 
         if (auto levelView = UnityEngine::Object::FindObjectOfType<GlobalNamespace::StandardLevelDetailView*>(true)) {
@@ -1,7 +1,10 @@
 #include "camera.hpp"
 
+#include <future>
+
 #include "BeatSaber/Settings/QualitySettings.hpp"
 #include "BeatSaber/Settings/Settings.hpp"
+#include "CustomTypes/AudioCapture.hpp"
 #include "CustomTypes/CameraRig.hpp"
 #include "GlobalNamespace/IRenderingParamsApplicator.hpp"
 #include "GlobalNamespace/MainCamera.hpp"
@@ -19,16 +22,23 @@
 #include "UnityEngine/StereoTargetEyeMask.hpp"
 #include "UnityEngine/Time.hpp"
 #include "bsml/shared/BSML/MainThreadScheduler.hpp"
+#include "capture.hpp"
 #include "config.hpp"
 #include "hollywood/shared/hollywood.hpp"
+#include "journal.hpp"
 #include "manager.hpp"
 #include "math.hpp"
 #include "metacore/shared/game.hpp"
 #include "metacore/shared/internals.hpp"
 #include "metacore/shared/operators.hpp"
 #include "metacore/shared/songs.hpp"
+#include "metacore/shared/stats.hpp"
 #include "metacore/shared/strings.hpp"
+#include "mp4.hpp"
+#include "pause.hpp"
+#include "persist.hpp"
 #include "playback.hpp"
+#include "queue.hpp"
 #include "utils.hpp"
 
 static Vector3 const BaseMovement = {0, 0, 1.5};
@@ -51,9 +61,23 @@ int uiCullingMask = 1 << 5;
 
 static bool moving = false;
 
-Hollywood::AudioCapture* audioCapture = nullptr;
+Replay::AudioCapture* audioCapture = nullptr;
 Hollywood::CameraCapture* videoCapture = nullptr;
-std::fstream videoOutput;
+
+// encoder and audio callbacks only queue their data, leaving the file writes to a separate thread
+static Capture::Writer videoWriter(32 << 20);
+static Capture::Writer audioWriter(4 << 20);
+static bool wroteWavHeader = false;
+
+static Mp4::Muxer muxer;
+static bool legacyMux = false;
+// seconds of video already in the file from an interrupted render
+static float resumeTime = 0;
+static bool resumeSeek = false;
+// both streams are closed, so their files are complete
+static Capture::Completion streamsClosed;
+
+static void QueueMux();
 
 static void SetGraphicsSettings() {
     auto applicator = UnityEngine::Resources::FindObjectsOfTypeAll<GlobalNamespace::SettingsApplicatorSO*>()->First();
@@ -103,6 +127,68 @@ static void UnsetGraphicsSettings() {
     logger.info("reset graphics settings");
 }
 
+namespace RenderRanges {
+    // sorted and without overlaps, each rendered back to back
+    static std::vector<TimeRange> ranges;
+    static int current = -1;
+
+    static void Load() {
+        ranges.clear();
+        current = -1;
+        auto sorted = Manager::GetRenderRanges();
+        std::sort(sorted.begin(), sorted.end(), [](TimeRange const& a, TimeRange const& b) { return a.Start < b.Start; });
+        for (auto range : sorted) {
+            range.Start = std::max(range.Start, 0.f);
+            if (range.End <= range.Start)
+                continue;
+            if (!ranges.empty() && range.Start <= ranges.back().End)
+                ranges.back().End = std::max(ranges.back().End, range.End);
+            else
+                ranges.emplace_back(range);
+        }
+        if (!ranges.empty())
+            logger.info("rendering {} time ranges", ranges.size());
+    }
+
+    // the range and song time for an amount of rendered time, with an index past the last range once they're all done
+    static std::pair<int, float> Map(float renderTime, float songEnd) {
+        for (int i = 0; i < ranges.size(); i++) {
+            float length = ranges[i].End - ranges[i].Start;
+            if (renderTime < length)
+                return {i, ranges[i].Start + renderTime};
+            renderTime -= length;
+        }
+        return {ranges.size(), songEnd};
+    }
+}
+
+static bool SameRender(LevelSelection first, LevelSelection second) {
+    // the description includes the status, which isn't needed to match
+    first.ReplayDesc = second.ReplayDesc = "";
+    return WriteToString(first) == WriteToString(second);
+}
+
+// the last checkpoint of an interrupted render of the same level and settings that is fully in the file
+static std::optional<Mp4::Checkpoint> FindResume(std::string const& settings, LevelSelection const& level) {
+    auto journal = Journal::Load();
+    if (!journal || journal->settings != settings || !SameRender(journal->level, level) || !fileexists(TmpOutPath))
+        return std::nullopt;
+    size_t size = std::filesystem::file_size(TmpOutPath);
+    for (auto checkpoint = journal->checkpoints.rbegin(); checkpoint != journal->checkpoints.rend(); checkpoint++) {
+        if (checkpoint->offset <= size)
+            return *checkpoint;
+    }
+    return std::nullopt;
+}
+
+// the channels the audio filter will get, from the output speaker mode
+static int GetAudioChannels() {
+    // raw, mono, stereo, quad, surround, 5.1, 7.1, prologic
+    static constexpr int ModeChannels[] = {2, 1, 2, 4, 5, 6, 8, 2};
+    int mode = (int) UnityEngine::AudioSettings::get_speakerMode();
+    return mode >= 0 && mode < std::size(ModeChannels) ? ModeChannels[mode] : 2;
+}
+
 static void SetupRecording() {
     SetGraphicsSettings();
 
@@ -156,25 +242,74 @@ static void SetupRecording() {
     if (height <= 0)
         height = Resolutions[getConfig().Resolution.GetValue()].second;
 
+    int sampleRate = UnityEngine::AudioSettings::get_outputSampleRate();
+    legacyMux = getConfig().LegacyMux.GetValue();
+
     videoCapture = customCamera->gameObject->AddComponent<Hollywood::CameraCapture*>();
-    videoOutput.open(TmpVidPath, std::ios::out | std::ios::binary);
-    videoCapture->onOutputUnit = [](uint8_t* data, size_t len) {
-        videoOutput.write((char*) data, len);
-    };
+    if (legacyMux) {
+        streamsClosed.Reset(2, QueueMux);
+        videoWriter.onClosed = []() {
+            streamsClosed.Signal();
+        };
+        audioWriter.onClosed = []() {
+            Capture::FinishWav(TmpAudPath);
+            streamsClosed.Signal();
+        };
+        videoWriter.Open(TmpVidPath);
+        videoCapture->onOutputUnit = [](uint8_t* data, size_t len) {
+            videoWriter.Push(data, len);
+        };
+    } else {
+        int fps = getConfig().FPS.GetValue();
+        bool hevc = getConfig().HEVC.GetValue();
+        int channels = GetAudioChannels();
+        auto settings = fmt::format("{}x{} {} {} {} {} {}", width, height, fps, hevc, getConfig().Bitrate.GetValue(), sampleRate, channels);
+        auto level = Manager::GetRenderSelection();
+
+        resumeTime = 0;
+        auto checkpoint = FindResume(settings, level);
+        if (checkpoint && muxer.Resume(TmpOutPath, width, height, fps, hevc, sampleRate, channels, *checkpoint))
+            resumeTime = checkpoint->time;
+        else
+            muxer.Open(TmpOutPath, width, height, fps, hevc, sampleRate, channels);
+        resumeSeek = resumeTime > 0;
+
+        Journal::Start(settings, level);
+        if (checkpoint && resumeTime > 0)
+            Journal::Record(*checkpoint);
+        muxer.onFragment = Journal::Record;
+        videoCapture->onOutputUnit = [](uint8_t* data, size_t len) {
+            muxer.AddVideo(data, len);
+        };
+    }
     int bitMult = getConfig().HEVC.GetValue() ? 1000 : 2000;
     videoCapture->Init(
         width, height, getConfig().FPS.GetValue(), getConfig().Bitrate.GetValue() * bitMult, getConfig().FOV.GetValue(), getConfig().HEVC.GetValue()
     );
 
     UnityEngine::Time::set_captureDeltaTime(1 / (float) getConfig().FPS.GetValue());
+    RenderRanges::Load();
 
     Hollywood::SetSyncTimes(true);
 
     logger.info("Beginning audio capture");
 
     auto audioListener = customCamera->GetComponentInChildren<UnityEngine::AudioListener*>();
-    audioCapture = audioListener->gameObject->AddComponent<Hollywood::AudioCapture*>();
-    audioCapture->OpenFile(TmpAudPath);
+    audioCapture = audioListener->gameObject->AddComponent<Replay::AudioCapture*>();
+    if (!legacyMux) {
+        audioCapture->sink = [](std::span<int16_t const> samples, int channels) {
+            muxer.AddAudio(samples, channels);
+        };
+    } else if (audioWriter.Open(TmpAudPath)) {
+        wroteWavHeader = false;
+        audioCapture->sink = [sampleRate](std::span<int16_t const> samples, int channels) {
+            if (!wroteWavHeader) {
+                Capture::WriteWavHeader(audioWriter, sampleRate, channels);
+                wroteWavHeader = true;
+            }
+            audioWriter.Push(samples.data(), samples.size_bytes());
+        };
+    }
 
     // make sure other audio listeners are disabled
     for (auto listener : UnityEngine::Object::FindObjectsOfType<UnityEngine::AudioListener*>())
@@ -198,7 +333,7 @@ static Replay::Transform const& GetHead() {
 }
 
 static CameraMode GetMode() {
-    CameraMode mode = (CameraMode) getConfig().CamMode.GetValue();
+    CameraMode mode = Manager::GetReplayConfig().mode;
     if (mode == CameraMode::Headset && Manager::Rendering())
         return CameraMode::Smooth;
     return mode;
@@ -218,8 +353,8 @@ static void SetMoving(bool value) {
     if (moving == value)
         return;
     if (!value) {
-        getConfig().ThirdPerPos.SetValue(cameraRig->GetPosition());
-        getConfig().ThirdPerRot.SetValue(cameraRig->GetRotation().eulerAngles);
+        Persist::Set(getConfig().ThirdPerPos, cameraRig->GetPosition());
+        Persist::Set(getConfig().ThirdPerRot, cameraRig->GetRotation().eulerAngles);
     }
     moving = value;
 }
@@ -227,9 +362,9 @@ static void SetMoving(bool value) {
 static void Travel(int direction) {
     if (direction == 0)
         return;
-    float delta = UnityEngine::Time::get_deltaTime() * getConfig().TravelSpeed.GetValue();
+    float delta = UnityEngine::Time::get_deltaTime() * Manager::GetReplayConfig().travelSpeed;
     baseCameraPosition += Sombrero::QuaternionMultiply(cameraRig->GetRotation(), BaseMovement * delta * direction);
-    getConfig().ThirdPerPos.SetValue(baseCameraPosition);
+    Persist::Set(getConfig().ThirdPerPos, baseCameraPosition);
 }
 
 void Camera::SetMode(int value) {
@@ -242,13 +377,6 @@ void Camera::SetMode(int value) {
     ResetBasePosition();
 }
 
-static Quaternion ApplyTilt(Quaternion const& rotation, float tilt) {
-    if (tilt == 0)
-        return rotation;
-    // rotate on local x axis
-    return Sombrero::QuaternionMultiply(rotation, Quaternion::Euler({tilt, 0, 0}));
-}
-
 static constexpr inline UnityEngine::Matrix4x4 MatrixTranslate(UnityEngine::Vector3 const& vector) {
     UnityEngine::Matrix4x4 result;
     result.m00 = 1;
@@ -270,6 +398,131 @@ static constexpr inline UnityEngine::Matrix4x4 MatrixTranslate(UnityEngine::Vect
     return result;
 }
 
+namespace SmoothTrack {
+    // the smooth camera path, filtered once from the head poses at a fixed rate so it doesn't depend on the framerate
+    struct Sample {
+        Vector3 position;
+        Quaternion rotation;
+    };
+
+    struct Track {
+        std::vector<Sample> samples;
+        float start = 0;
+        float rate = 0;
+    };
+
+    static constexpr float DefaultRate = 90;
+    // settings changes, like dragging the smoothing slider, only rebuild the track once they stop for this long
+    static constexpr float RebuildDelay = 0.3;
+
+    using Settings = std::tuple<float, bool, float, Vector3, float>;
+
+    static Track track;
+    static std::future<Track> building;
+    // the settings used to build the track, to rebuild it if they change
+    static Settings settings;
+    static Settings changed;
+    static float changeTime;
+
+    static Settings GetSettings() {
+        auto& config = Manager::GetReplayConfig();
+        float rate = Manager::Rendering() ? config.fps : DefaultRate;
+        return {config.smoothing, config.correction, config.targetTilt, config.offset, rate};
+    }
+
+    // sampled on a separate thread from its own reader, so long streamed replays aren't read on the main thread
+    // and the playback window isn't moved
+    static void Build() {
+        settings = GetSettings();
+        changed = settings;
+        float smoothing = std::get<0>(settings);
+        float tilt = std::get<2>(settings);
+        Vector3 offset = std::get<3>(settings);
+        float rate = std::get<4>(settings);
+
+        auto replay = Manager::GetCurrentReplayShared();
+        // anything that needs il2cpp is done here, so the thread only does plain math
+        std::optional<Quaternion> correctionRotation, tiltRotation;
+        if (std::get<1>(settings))
+            correctionRotation = replay->info.averageOffset;
+        if (tilt != 0)
+            tiltRotation = Quaternion::Euler({tilt, 0, 0});
+        bool rotateOffset = Manager::HasRotations();
+
+        std::promise<Track> promise;
+        building = promise.get_future();
+        std::thread([=, promise = std::move(promise)]() mutable {
+            Track ret;
+            ret.rate = rate;
+            float amount = 2 / (rate * smoothing);
+            Vector3 position;
+            Quaternion rotation;
+            Playback::SamplePoses(*replay, rate, [&](Replay::Pose const& pose) {
+                if (ret.samples.empty()) {
+                    ret.start = pose.time;
+                    position = pose.head.position;
+                    rotation = pose.head.rotation;
+                } else {
+                    position = EaseLerp(position, pose.head.position, pose.time, amount);
+                    rotation = Slerp(rotation, pose.head.rotation, amount);
+                }
+                auto cameraRotation = rotation;
+                if (correctionRotation)
+                    cameraRotation = Sombrero::QuaternionMultiply(cameraRotation, *correctionRotation);
+                // rotate on local x axis
+                if (tiltRotation)
+                    cameraRotation = Sombrero::QuaternionMultiply(cameraRotation, *tiltRotation);
+                auto cameraOffset = rotateOffset ? Sombrero::QuaternionMultiply(cameraRotation, offset) : offset;
+                ret.samples.push_back({position + cameraOffset, cameraRotation});
+            });
+            promise.set_value(std::move(ret));
+        }).detach();
+    }
+
+    static void Reset() {
+        track = {};
+        building = {};
+    }
+
+    static void Update() {
+        auto current = GetSettings();
+        float now = UnityEngine::Time::get_realtimeSinceStartup();
+        if (track.rate == 0 && !building.valid())
+            Build();
+        else if (current != settings) {
+            if (current != changed) {
+                changed = current;
+                changeTime = now;
+            }
+            if (now - changeTime >= RebuildDelay)
+                Build();
+        }
+
+        // renders need every frame to be exact, so they wait for the track
+        if (building.valid() && (Manager::Rendering() || building.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+            track = building.get();
+            logger.debug("built smooth camera track with {} samples at {} fps", track.samples.size(), track.rate);
+        }
+    }
+
+    static Sample Get(float time) {
+        Update();
+        auto const& samples = track.samples;
+        if (samples.empty())
+            return {GetHead().position, GetHead().rotation};
+        float slot = (time - track.start) * track.rate;
+        if (slot <= 0)
+            return samples.front();
+        int prev = slot;
+        if (prev >= samples.size() - 1)
+            return samples.back();
+        float t = slot - prev;
+        auto& first = samples[prev];
+        auto& second = samples[prev + 1];
+        return {Vector3::Lerp(first.position, second.position, t), Quaternion::Lerp(first.rotation, second.rotation, t)};
+    }
+}
+
 void Camera::SetupCamera() {
     logger.debug("setting up camera");
     // set culling matrix for moved camera modes and for rendering
@@ -294,58 +547,101 @@ void Camera::SetupCamera() {
 
     cameraRig = Replay::CameraRig::Create(mainCamera->transform);
     ResetBasePosition();
+    SmoothTrack::Reset();
+    if (GetMode() == CameraMode::Smooth)
+        SmoothTrack::Build();
     moving = false;
 }
 
-static void FinishMux() {
-    if (getConfig().CleanFiles.GetValue()) {
-        if (fileexists(TmpVidPath))
-            std::filesystem::remove(TmpVidPath);
-        if (fileexists(TmpAudPath))
-            std::filesystem::remove(TmpAudPath);
-    }
-
-    logger.info("Removing screen on");
-    if (MetaCore::Internals::mapWasQuit || getConfig().RenderQueue.GetValue().empty())
-        Hollywood::SetScreenOn(false);
-
-    Manager::CameraFinished();
-}
+// output names given to mux jobs that haven't created their file yet
+static std::set<std::string> reservedOutputs;
+static int muxJobs = 0;
 
-static void DoMux() {
+static std::string ReserveOutput() {
     std::string outputFile = fmt::format("{}/{}.mp4", RendersFolder, fileName);
     int num = 1;
-    while (fileexists(outputFile))
+    while (fileexists(outputFile) || reservedOutputs.contains(outputFile))
         outputFile = fmt::format("{}/{}_{}.mp4", RendersFolder, fileName, num++);
+    reservedOutputs.emplace(outputFile);
+    return outputFile;
+}
 
-    Hollywood::MuxFilesSync(TmpVidPath, TmpAudPath, TmpOutPath, getConfig().FPS.GetValue());
-
-    if (fileexists(TmpOutPath)) {
-        // idk how but I got a "no such file or directory" error here once
-        int tries = 2;
-        while (tries-- > 0) {
-            try {
-                std::filesystem::rename(TmpOutPath, outputFile);
-                break;
-            } catch (std::exception const& e) {
-                logger.error("filesystem error renaming file {} -> {}: {}", TmpOutPath, outputFile, e.what());
-                std::this_thread::sleep_for(std::chrono::milliseconds(250));
-            }
-        }
+// only called once the file at from is closed, so it always exists in full if it was written
+static void MoveOutput(std::string const& from, std::string const& to) {
+    if (!fileexists(from)) {
+        logger.error("output {} was not written", from);
+        return;
     }
-    FinishMux();
+    try {
+        std::filesystem::rename(from, to);
+    } catch (std::exception const& e) {
+        logger.error("filesystem error renaming file {} -> {}: {}", from, to, e.what());
+    }
+}
+
+static void StopScreenOn() {
+    // keep the device awake until queued muxes are done too
+    if (Capture::PendingJobs() > 0)
+        return;
+    logger.info("Removing screen on");
+    Hollywood::SetScreenOn(false);
 }
 
-static void WaitThenMux() {
+static void FinishMux() {
+    if (MetaCore::Internals::mapWasQuit || Queue::Empty())
+        StopScreenOn();
+
+    Manager::CameraFinished();
+}
+
+static void QueueMux() {
     bool vidExists = fileexists(TmpVidPath);
     bool audExists = fileexists(TmpAudPath);
 
-    if (vidExists && audExists)
-        BSML::MainThreadScheduler::ScheduleAfterTime(5, DoMux);
-    else {
+    if (!vidExists || !audExists) {
         logger.error("Cannot mux. Video exists: {} Audio exists: {}", vidExists, audExists);
         FinishMux();
+        return;
     }
+
+    // give the job its own files so the next render can start capturing while it runs
+    int job = muxJobs++;
+    std::string video = fmt::format("/sdcard/replay-tmp-{}.h264", job);
+    std::string audio = fmt::format("/sdcard/replay-tmp-{}.wav", job);
+    std::string muxed = fmt::format("/sdcard/replay-tmp-mux-{}.mp4", job);
+    try {
+        std::filesystem::rename(TmpVidPath, video);
+        std::filesystem::rename(TmpAudPath, audio);
+    } catch (std::exception const& e) {
+        logger.error("filesystem error moving files for mux: {}", e.what());
+        FinishMux();
+        return;
+    }
+
+    std::string output = ReserveOutput();
+    int fps = getConfig().FPS.GetValue();
+    bool clean = getConfig().CleanFiles.GetValue();
+    logger.info("Queueing mux to {}", output);
+
+    Capture::SubmitJob(
+        [video, audio, muxed, output, fps, clean]() {
+            Hollywood::MuxFilesSync(video, audio, muxed, fps);
+            MoveOutput(muxed, output);
+            if (clean) {
+                std::filesystem::remove(video);
+                std::filesystem::remove(audio);
+            }
+            logger.info("Finished mux to {}", output);
+        },
+        [output]() {
+            BSML::MainThreadScheduler::Schedule([output]() {
+                reservedOutputs.erase(output);
+                if (!Manager::Rendering())
+                    StopScreenOn();
+            });
+        }
+    );
+    FinishMux();
 }
 
 void Camera::FinishReplay() {
@@ -355,6 +651,7 @@ void Camera::FinishReplay() {
     if (audioCapture)
         UnityEngine::Object::DestroyImmediate(audioCapture);
     audioCapture = nullptr;
+    audioWriter.Close();
     if (videoCapture)
         UnityEngine::Object::DestroyImmediate(videoCapture->gameObject);
     videoCapture = nullptr;
@@ -365,9 +662,26 @@ void Camera::FinishReplay() {
     if (Manager::Rendering()) {
         Hollywood::SetSyncTimes(false);
         UnityEngine::Time::set_captureDeltaTime(0);
-        videoOutput.close();
         MetaCore::Game::SetCameraFadeOut(MOD_ID, true, 0);
-        WaitThenMux();
+        if (legacyMux) {
+            // muxes once the audio has closed as well
+            videoWriter.Close();
+        } else {
+            // the file is already complete apart from the last fragment
+            muxer.Finish();
+            if (MetaCore::Internals::mapWasQuit) {
+                // the queue stops on quit, and the next render of this entry resumes the partial file instead of overwriting it
+                logger.info("Keeping partial render to resume later");
+                Journal::MarkQuit();
+                Manager::RequeueRender();
+            } else {
+                Journal::Clear();
+                std::string output = ReserveOutput();
+                MoveOutput(TmpOutPath, output);
+                reservedOutputs.erase(output);
+            }
+            FinishMux();
+        }
         UnsetGraphicsSettings();
         // make distortions work for the headset camera again
         Camera::reinitDistortions = 3;
@@ -398,24 +712,6 @@ void Camera::OnRestart() {
     oldCullingMask = 0;
 }
 
-static Quaternion GetCameraRotation() {
-    if (GetMode() != CameraMode::Smooth)
-        return baseCameraRotation;
-    auto ret = baseCameraRotation;
-    if (getConfig().Correction.GetValue())
-        ret = Sombrero::QuaternionMultiply(baseCameraRotation, Manager::GetCurrentInfo().averageOffset);
-    return ApplyTilt(ret, getConfig().TargetTilt.GetValue());
-}
-
-static Vector3 GetCameraPosition() {
-    if (GetMode() != CameraMode::Smooth)
-        return baseCameraPosition;
-    auto offset = getConfig().Offset.GetValue();
-    if (Manager::HasRotations())
-        offset = Sombrero::QuaternionMultiply(GetCameraRotation(), offset);
-    return baseCameraPosition + offset;
-}
-
 static void UpdateDSPOffset(GlobalNamespace::AudioTimeSyncController* self) {
     // default dsp time offset calculation
     float estimatedTimeIncrease = UnityEngine::Time::get_deltaTime() * self->_timeScale;
@@ -438,7 +734,20 @@ bool Camera::UpdateTime(GlobalNamespace::AudioTimeSyncController* controller) {
     if (!videoCapture || !Manager::Rendering() || Manager::Paused())
         return true;
     UpdateDSPOffset(controller);
-    float time = std::max(controller->_songTime, videoCapture->GetRenderTime() * controller->_timeScale);
+    float time = (videoCapture->GetRenderTime() + resumeTime) * controller->_timeScale;
+    if (RenderRanges::ranges.empty() && resumeSeek) {
+        resumeSeek = false;
+        Pause::SetTime(time);
+    } else if (!RenderRanges::ranges.empty()) {
+        auto [range, songTime] = RenderRanges::Map(time, controller->songEndTime);
+        // jump over everything between ranges, and to the end after the last one
+        if (range != RenderRanges::current) {
+            RenderRanges::current = range;
+            Pause::SetTime(songTime);
+        }
+        time = songTime;
+    }
+    time = std::max(controller->_songTime, time);
     controller->_lastFrameDeltaSongTime = time - controller->_songTime;
     controller->_songTime = time;
     controller->_isReady = true;
@@ -448,17 +757,17 @@ bool Camera::UpdateTime(GlobalNamespace::AudioTimeSyncController* controller) {
 static void UpdateCameraTransform(GlobalNamespace::PlayerTransforms* player) {
     CameraMode mode = GetMode();
 
-    if (mode == CameraMode::Smooth) {
-        float deltaTime = UnityEngine::Time::get_deltaTime();
-        auto& head = GetHead();
-        baseCameraPosition =
-            EaseLerp(baseCameraPosition, head.position, UnityEngine::Time::get_time(), deltaTime * 2 / getConfig().Smoothing.GetValue());
-        baseCameraRotation = Slerp(baseCameraRotation, head.rotation, deltaTime * 2 / getConfig().Smoothing.GetValue());
-    } else if (mode == CameraMode::ThirdPerson)
+    if (mode == CameraMode::ThirdPerson)
         ResetBasePosition();
 
-    Vector3 cameraPosition = GetCameraPosition();
-    Quaternion cameraRotation = GetCameraRotation();
+    Vector3 cameraPosition = baseCameraPosition;
+    Quaternion cameraRotation = baseCameraRotation;
+    if (mode == CameraMode::Smooth) {
+        auto sample = SmoothTrack::Get(MetaCore::Stats::GetSongTime());
+        cameraPosition = sample.position;
+        cameraRotation = sample.rotation;
+    }
+
     if (mode == CameraMode::Smooth && Manager::GetCurrentInfo().positionsAreLocal) {
         auto parent = player->_originParentTransform ? player->_originParentTransform : cameraRig->fakeHead->parent;
         cameraPosition = Quaternion(parent->rotation) * cameraPosition + parent->position;
@@ -490,19 +799,35 @@ void Camera::UpdateCamera(GlobalNamespace::PlayerTransforms* player) {
 
     cameraRig->SetTrackingEnabled(!overridePosition || moving, moving);
 
-    bool enabled = mode == CameraMode::ThirdPerson && !Manager::Paused() && getConfig().Avatar.GetValue();
+    bool enabled = mode == CameraMode::ThirdPerson && !Manager::Paused() && Manager::GetReplayConfig().avatar;
     cameraRig->avatar->gameObject->active = enabled;
     if (enabled)
         cameraRig->avatar->UpdateTransforms(
             pose.head.position, pose.leftHand.position, pose.rightHand.position, pose.head.rotation, pose.leftHand.rotation, pose.rightHand.rotation
         );
+
+    for (int i = 0; i < cameraRig->ghosts.size(); i++) {
+        auto ghost = cameraRig->ghosts[i];
+        ghost->gameObject->active = enabled;
+        if (!enabled)
+            continue;
+        auto& ghostPose = Playback::GetGhostPose(i);
+        ghost->UpdateTransforms(
+            ghostPose.head.position,
+            ghostPose.leftHand.position,
+            ghostPose.rightHand.position,
+            ghostPose.head.rotation,
+            ghostPose.leftHand.rotation,
+            ghostPose.rightHand.rotation
+        );
+    }
 }
 
 void Camera::UpdateInputs() {
     if (GetMode() != CameraMode::ThirdPerson || Manager::Rendering())
         return;
-    SetMoving(Utils::IsButtonDown(getConfig().MoveButton.GetValue()));
-    Travel(Utils::IsButtonDown(getConfig().TravelButton.GetValue()));
+    SetMoving(Utils::IsButtonDown(Manager::GetReplayConfig().moveButton));
+    Travel(Utils::IsButtonDown(Manager::GetReplayConfig().travelButton));
 }
 
 void Camera::CreateReplayText() {
@@ -0,0 +1,259 @@
+#include "capture.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <deque>
+
+using namespace Capture;
+
+Writer::Writer(size_t capacity) : capacity(capacity) {}
+
+Writer::~Writer() {
+    onClosed = nullptr;
+    Close();
+}
+
+bool Writer::Open(std::string const& path, bool append) {
+    Close();
+    file = ::open(path.c_str(), O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0644);
+    if (file < 0) {
+        logger.error("failed to open capture file {}: {}", path, strerror(errno));
+        return false;
+    }
+    // kept once allocated, since capture callbacks can still arrive after closing
+    if (!buffer)
+        buffer.reset(new uint8_t[capacity]);
+    this->path = path;
+    head = 0;
+    tail = 0;
+    stats = {};
+    closing = false;
+    open = true;
+    thread = std::thread(&Writer::Work, this);
+    return true;
+}
+
+void Writer::Push(void const* data, size_t size) {
+    pushing++;
+    if (closing || !open) {
+        Finish();
+        return;
+    }
+    auto bytes = (uint8_t const*) data;
+
+    while (size > 0) {
+        size_t start = head.load(std::memory_order_relaxed);
+        size_t free = capacity - (start - tail.load(std::memory_order_acquire));
+        if (free == 0) {
+            stats.stalls++;
+            auto stallStart = std::chrono::steady_clock::now();
+            while (capacity - (start - tail.load(std::memory_order_acquire)) == 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            stats.stallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - stallStart).count();
+            continue;
+        }
+        size_t offset = start % capacity;
+        size_t count = std::min({size, free, capacity - offset});
+        memcpy(buffer.get() + offset, bytes, count);
+        head.store(start + count, std::memory_order_release);
+        bytes += count;
+        size -= count;
+        // the writer only waits for whole blocks
+        if (start + count - tail.load(std::memory_order_acquire) >= WriteBlock) {
+            std::unique_lock lock(mutex);
+            condition.notify_all();
+        }
+    }
+    Finish();
+}
+
+void Writer::Finish() {
+    if (--pushing == 0 && closing) {
+        std::unique_lock lock(mutex);
+        condition.notify_all();
+    }
+}
+
+void Writer::Close() {
+    auto closed = std::move(onClosed);
+    onClosed = nullptr;
+    if (!open) {
+        if (closed)
+            closed();
+        return;
+    }
+    {
+        std::unique_lock lock(mutex);
+        closing = true;
+        condition.notify_all();
+        condition.wait(lock, [this]() { return pushing == 0; });
+    }
+    if (thread.joinable())
+        thread.join();
+    ::close(file);
+    file = -1;
+    open = false;
+    logger.info(
+        "wrote {} bytes to {} in {} writes, {} stalls for {:.3f}s, at most {} bytes queued",
+        stats.bytes,
+        path,
+        stats.writes,
+        stats.stalls,
+        stats.stallSeconds,
+        stats.maxQueued
+    );
+    if (closed)
+        closed();
+}
+
+void Writer::Work() {
+    while (true) {
+        size_t start = tail.load(std::memory_order_relaxed);
+        size_t queued = head.load(std::memory_order_acquire) - start;
+        stats.maxQueued = std::max(stats.maxQueued, queued);
+
+        // only write whole blocks until closing, so every write is large and at an aligned offset
+        bool finishing = closing;
+        size_t offset = start % capacity;
+        size_t count = std::min(queued, capacity - offset);
+        if (!finishing)
+            count -= count % WriteBlock;
+
+        if (count == 0) {
+            if (finishing && queued == 0)
+                return;
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [this, start]() { return closing || head.load(std::memory_order_acquire) - start >= WriteBlock; });
+            continue;
+        }
+
+        size_t written = 0;
+        while (written < count) {
+            auto ret = ::write(file, buffer.get() + offset + written, count - written);
+            if (ret < 0) {
+                if (errno == EINTR)
+                    continue;
+                logger.error("failed to write capture file {}: {}", path, strerror(errno));
+                break;
+            }
+            written += ret;
+        }
+        stats.bytes += written;
+        stats.writes++;
+        // skip the data even if the write failed, so the capture thread doesn't stall forever
+        tail.store(start + count, std::memory_order_release);
+    }
+}
+
+void Completion::Reset(int streams, std::function<void()> done) {
+    std::unique_lock lock(mutex);
+    remaining = streams;
+    this->done = std::move(done);
+}
+
+void Completion::Signal() {
+    std::function<void()> finished;
+    {
+        std::unique_lock lock(mutex);
+        if (remaining <= 0 || --remaining > 0)
+            return;
+        finished = std::move(done);
+        done = nullptr;
+    }
+    if (finished)
+        finished();
+}
+
+#pragma pack(push, 1)
+struct WavHeader {
+    char riff[4] = {'R', 'I', 'F', 'F'};
+    uint32_t riffSize = 0;
+    char wave[4] = {'W', 'A', 'V', 'E'};
+    char fmt[4] = {'f', 'm', 't', ' '};
+    uint32_t fmtSize = 16;
+    uint16_t format = 1;
+    uint16_t channels;
+    uint32_t sampleRate;
+    uint32_t byteRate;
+    uint16_t blockAlign;
+    uint16_t bitsPerSample = 16;
+    char data[4] = {'d', 'a', 't', 'a'};
+    uint32_t dataSize = 0;
+};
+#pragma pack(pop)
+
+void Capture::WriteWavHeader(Writer& writer, int sampleRate, int channels) {
+    WavHeader header;
+    header.channels = channels;
+    header.sampleRate = sampleRate;
+    header.blockAlign = channels * sizeof(int16_t);
+    header.byteRate = sampleRate * header.blockAlign;
+    writer.Push(&header, sizeof(WavHeader));
+}
+
+void Capture::FinishWav(std::string const& path) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekg(0, std::ios::end);
+    size_t size = file.tellg();
+    if (!file || size < sizeof(WavHeader)) {
+        logger.error("wav file {} is missing its header", path);
+        return;
+    }
+    uint32_t riffSize = size - 8;
+    uint32_t dataSize = size - sizeof(WavHeader);
+    file.seekp(offsetof(WavHeader, riffSize));
+    file.write((char const*) &riffSize, sizeof(uint32_t));
+    file.seekp(offsetof(WavHeader, dataSize));
+    file.write((char const*) &dataSize, sizeof(uint32_t));
+}
+
+namespace Jobs {
+    static std::mutex mutex;
+    static std::condition_variable condition;
+    static std::deque<std::pair<std::function<void()>, std::function<void()>>> queue;
+    static int pending = 0;
+    static bool started = false;
+
+    static void Work() {
+        while (true) {
+            std::function<void()> job, finished;
+            {
+                std::unique_lock lock(mutex);
+                condition.wait(lock, []() { return !queue.empty(); });
+                std::tie(job, finished) = std::move(queue.front());
+                queue.pop_front();
+            }
+            try {
+                job();
+            } catch (std::exception const& e) {
+                logger.error("capture job failed: {}", e.what());
+            }
+            {
+                std::unique_lock lock(mutex);
+                pending--;
+            }
+            if (finished)
+                finished();
+        }
+    }
+}
+
+void Capture::SubmitJob(std::function<void()> job, std::function<void()> finished) {
+    {
+        std::unique_lock lock(Jobs::mutex);
+        Jobs::queue.emplace_back(std::move(job), std::move(finished));
+        Jobs::pending++;
+        // lives for the rest of the game, like the capture writers
+        if (!Jobs::started) {
+            std::thread(Jobs::Work).detach();
+            Jobs::started = true;
+        }
+    }
+    Jobs::condition.notify_one();
+}
+
+int Capture::PendingJobs() {
+    std::unique_lock lock(Jobs::mutex);
+    return Jobs::pending;
+}
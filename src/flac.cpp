@@ -0,0 +1,324 @@
+#include "flac.hpp"
+
+using namespace Flac;
+
+static constexpr int MaxFixedOrder = 4;
+static constexpr int MaxPartitionOrder = 8;
+static constexpr int MaxRiceParameter = 14;
+
+enum ChannelAssignment { Independent = 0, LeftSide = 8, SideRight = 9, MidSide = 10 };
+
+namespace {
+    class BitWriter {
+       public:
+        explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+        void Write(uint64_t value, int bits) {
+            while (bits > 0) {
+                int count = std::min(bits, 32);
+                bits -= count;
+                uint32_t part = (value >> bits) & ((1ull << count) - 1);
+                buffer = (buffer << count) | part;
+                pending += count;
+                while (pending >= 8) {
+                    pending -= 8;
+                    out.push_back(buffer >> pending);
+                }
+            }
+        }
+
+        void WriteSigned(int32_t value, int bits) { Write((uint32_t) value & ((1ull << bits) - 1), bits); }
+
+        void WriteRice(int32_t value, int parameter) {
+            uint32_t folded = ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+            uint32_t quotient = folded >> parameter;
+            while (quotient >= 32) {
+                Write(0, 32);
+                quotient -= 32;
+            }
+            Write(1, quotient + 1);
+            Write(folded & ((1u << parameter) - 1), parameter);
+        }
+
+        void Align() {
+            if (pending > 0)
+                Write(0, 8 - pending);
+        }
+
+       private:
+        std::vector<uint8_t>& out;
+        uint64_t buffer = 0;
+        int pending = 0;
+    };
+}
+
+static uint8_t Crc8(uint8_t const* data, size_t size) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+            crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+static uint16_t Crc16(uint8_t const* data, size_t size) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i] << 8;
+        for (int bit = 0; bit < 8; bit++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x8005 : crc << 1;
+    }
+    return crc;
+}
+
+static void WriteUtf8(BitWriter& writer, uint32_t value) {
+    if (value < 0x80) {
+        writer.Write(value, 8);
+        return;
+    }
+    int bytes = 2;
+    while (bytes < 6 && value >= (1u << (5 * bytes + 1)))
+        bytes++;
+    writer.Write(((0xff00 >> bytes) & 0xff) | (value >> (6 * (bytes - 1))), 8);
+    for (int i = bytes - 2; i >= 0; i--)
+        writer.Write(0x80 | ((value >> (6 * i)) & 0x3f), 8);
+}
+
+// residual of the fixed polynomial predictor of an order, which only uses differences of previous samples
+static void FixedResidual(std::vector<int32_t> const& signal, int order, std::vector<int32_t>& residual) {
+    int size = signal.size();
+    residual.resize(size);
+    auto const* x = signal.data();
+    for (int i = order; i < size; i++) {
+        switch (order) {
+            case 0:
+                residual[i] = x[i];
+                break;
+            case 1:
+                residual[i] = x[i] - x[i - 1];
+                break;
+            case 2:
+                residual[i] = x[i] - 2 * x[i - 1] + x[i - 2];
+                break;
+            case 3:
+                residual[i] = x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+                break;
+            case 4:
+                residual[i] = x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+                break;
+        }
+    }
+}
+
+static uint64_t Fold(int32_t value) {
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+// the rice parameter for a partition from the mean of its folded values
+static int RiceParameter(uint64_t sum, int count) {
+    int parameter = 0;
+    while (parameter < MaxRiceParameter && ((uint64_t) count << (parameter + 1)) < sum)
+        parameter++;
+    return parameter;
+}
+
+static uint64_t RiceBits(uint64_t sum, int count, int parameter) {
+    return 4 + (uint64_t) count * (parameter + 1) + (sum >> parameter);
+}
+
+struct Partitioning {
+    int order = 0;
+    uint64_t bits = std::numeric_limits<uint64_t>::max();
+    std::array<int, 1 << MaxPartitionOrder> parameters;
+};
+
+// picks the partition order and parameters with the fewest bits, summing the finest partitions into the coarser ones
+static Partitioning ChoosePartitions(std::vector<int32_t> const& residual, int predictorOrder) {
+    int size = residual.size();
+    int maxOrder = 0;
+    while (maxOrder < MaxPartitionOrder && size % (2 << maxOrder) == 0 && (size >> (maxOrder + 1)) > predictorOrder)
+        maxOrder++;
+
+    std::array<uint64_t, 1 << MaxPartitionOrder> sums = {};
+    int partitions = 1 << maxOrder;
+    int partitionSize = size >> maxOrder;
+    for (int p = 0; p < partitions; p++) {
+        int start = p == 0 ? predictorOrder : p * partitionSize;
+        for (int i = start; i < (p + 1) * partitionSize; i++)
+            sums[p] += Fold(residual[i]);
+    }
+
+    Partitioning best;
+    for (int order = maxOrder; order >= 0; order--) {
+        int count = 1 << order;
+        int length = size >> order;
+        Partitioning current;
+        current.order = order;
+        current.bits = 0;
+        for (int p = 0; p < count; p++) {
+            int samples = p == 0 ? length - predictorOrder : length;
+            current.parameters[p] = RiceParameter(sums[p], samples);
+            current.bits += RiceBits(sums[p], samples, current.parameters[p]);
+        }
+        if (current.bits < best.bits)
+            best = current;
+        for (int p = 0; p < count / 2; p++)
+            sums[p] = sums[2 * p] + sums[2 * p + 1];
+    }
+    return best;
+}
+
+struct Subframe {
+    bool constant = false;
+    int order = 0;
+    Partitioning partitions;
+    uint64_t bits = std::numeric_limits<uint64_t>::max();
+};
+
+static Subframe ChooseSubframe(std::vector<int32_t> const& signal, int bps, std::vector<int32_t>& residual) {
+    Subframe best;
+    if (std::all_of(signal.begin(), signal.end(), [&signal](int32_t value) { return value == signal[0]; })) {
+        best.constant = true;
+        best.bits = 8 + bps;
+        return best;
+    }
+    int size = signal.size();
+    for (int order = 0; order <= MaxFixedOrder && order < size; order++) {
+        FixedResidual(signal, order, residual);
+        auto partitions = ChoosePartitions(residual, order);
+        uint64_t bits = 8 + order * bps + 6 + partitions.bits;
+        if (bits < best.bits) {
+            best.order = order;
+            best.partitions = partitions;
+            best.bits = bits;
+        }
+    }
+    return best;
+}
+
+static void WriteSubframe(
+    BitWriter& writer, std::vector<int32_t> const& signal, int bps, Subframe const& subframe, std::vector<int32_t>& residual
+) {
+    if (subframe.constant) {
+        writer.Write(0, 8);
+        writer.WriteSigned(signal[0], bps);
+        return;
+    }
+    // fixed predictor type, no wasted bits
+    writer.Write((0x08 | subframe.order) << 1, 8);
+    for (int i = 0; i < subframe.order; i++)
+        writer.WriteSigned(signal[i], bps);
+
+    FixedResidual(signal, subframe.order, residual);
+    auto const& partitions = subframe.partitions;
+    writer.Write(0, 2);
+    writer.Write(partitions.order, 4);
+    int length = signal.size() >> partitions.order;
+    for (int p = 0; p < (1 << partitions.order); p++) {
+        int parameter = partitions.parameters[p];
+        writer.Write(parameter, 4);
+        int start = p == 0 ? subframe.order : p * length;
+        for (int i = start; i < (p + 1) * length; i++)
+            writer.WriteRice(residual[i], parameter);
+    }
+}
+
+Encoder::Encoder(int sampleRate, int channels) : sampleRate(sampleRate), channels(std::clamp(channels, 1, 8)) {}
+
+std::vector<uint8_t> Encoder::StreamInfo() const {
+    std::vector<uint8_t> ret;
+    BitWriter writer(ret);
+    writer.Write(BlockSize, 16);
+    writer.Write(BlockSize, 16);
+    // frame sizes and the total length aren't known while capturing
+    writer.Write(0, 24);
+    writer.Write(0, 24);
+    writer.Write(sampleRate, 20);
+    writer.Write(channels - 1, 3);
+    writer.Write(16 - 1, 5);
+    writer.Write(0, 36);
+    for (int i = 0; i < 16; i++)
+        writer.Write(0, 8);
+    return ret;
+}
+
+void Encoder::EncodeFrame(std::span<int16_t const> samples, uint32_t frameNumber, std::vector<uint8_t>& out) {
+    int size = std::min<int>(samples.size() / channels, BlockSize);
+    if (size <= 0)
+        return;
+
+    for (int channel = 0; channel < channels; channel++) {
+        signals[channel].resize(size);
+        for (int i = 0; i < size; i++)
+            signals[channel][i] = samples[i * channels + channel];
+    }
+
+    // stereo can store the difference between channels at one extra bit, which is usually much smaller
+    ChannelAssignment assignment = Independent;
+    std::array<int, 2> sources = {0, 1};
+    std::array<int, 2> depths = {16, 16};
+    std::array<Subframe, 8> subframes;
+    if (channels == 2) {
+        auto& mid = signals[2];
+        auto& side = signals[3];
+        mid.resize(size);
+        side.resize(size);
+        for (int i = 0; i < size; i++) {
+            mid[i] = (signals[0][i] + signals[1][i]) >> 1;
+            side[i] = signals[0][i] - signals[1][i];
+        }
+        for (int signal = 0; signal < 4; signal++)
+            subframes[signal] = ChooseSubframe(signals[signal], signal == 3 ? 17 : 16, residual);
+
+        uint64_t left = subframes[0].bits, right = subframes[1].bits, middle = subframes[2].bits, difference = subframes[3].bits;
+        uint64_t best = left + right;
+        if (left + difference < best) {
+            best = left + difference;
+            assignment = LeftSide;
+            sources = {0, 3};
+            depths = {16, 17};
+        }
+        if (difference + right < best) {
+            best = difference + right;
+            assignment = SideRight;
+            sources = {3, 1};
+            depths = {17, 16};
+        }
+        if (middle + difference < best) {
+            assignment = MidSide;
+            sources = {2, 3};
+            depths = {16, 17};
+        }
+    } else {
+        for (int channel = 0; channel < channels; channel++)
+            subframes[channel] = ChooseSubframe(signals[channel], 16, residual);
+    }
+
+    size_t start = out.size();
+    BitWriter writer(out);
+    // sync code with fixed block sizes
+    writer.Write(0xfff8, 16);
+    // block size as a 16 bit value at the end of the header, sample rate from the streaminfo
+    writer.Write(0x7, 4);
+    writer.Write(0x0, 4);
+    writer.Write(assignment == Independent ? channels - 1 : assignment, 4);
+    // 16 bits per sample
+    writer.Write(0x4, 3);
+    writer.Write(0, 1);
+    WriteUtf8(writer, frameNumber);
+    writer.Write(size - 1, 16);
+    writer.Write(Crc8(out.data() + start, out.size() - start), 8);
+
+    if (channels == 2) {
+        for (int i = 0; i < 2; i++)
+            WriteSubframe(writer, signals[sources[i]], depths[i], subframes[sources[i]], residual);
+    } else {
+        for (int channel = 0; channel < channels; channel++)
+            WriteSubframe(writer, signals[channel], 16, subframes[channel], residual);
+    }
+
+    writer.Align();
+    uint16_t crc = Crc16(out.data() + start, out.size() - start);
+    writer.Write(crc, 16);
+}
@@ -2,6 +2,7 @@
 #include "math.hpp"
 #include "metacore/shared/unity.hpp"
 #include "parsing.hpp"
+#include "poses.hpp"
 #include "utils.hpp"
 
 // loading code for beatleader's replay format: https://github.com/BeatLeader/BS-Open-Replay
@@ -185,9 +186,10 @@ static BSOR::Info ParseInfo(std::ifstream& input, Replay::Data& replay, bool pra
     return info;
 }
 
-static void ParsePoses(std::ifstream& input, Replay::Data& replay, bool hasRotation) {
+static void ParsePoses(std::ifstream& input, Replay::Data& replay, bool hasRotation, std::string const& path) {
     int count;
     READ_TO(count);
+    auto offset = input.tellg();
 
     MetaCore::Engine::QuaternionAverage averageCalc(Quaternion::identity(), hasRotation);
 
@@ -225,6 +227,14 @@ static void ParsePoses(std::ifstream& input, Replay::Data& replay, bool hasRotat
     }
 
     replay.info.averageOffset = Quaternion::Inverse(averageCalc.GetAverage());
+
+    // long replays are read from the file during playback, which needs every pose in it to be used
+    if (replay.poses.size() >= Replay::PoseStream::MinPoses && duplicates == 0) {
+        logger.debug("streaming {} poses from file", replay.poses.size());
+        replay.poseStream = std::make_shared<Replay::PoseStream>(path, offset, replay.poses);
+        replay.poses.clear();
+        replay.poses.shrink_to_fit();
+    }
 }
 
 static void ParseNotes(std::ifstream& input, Replay::Data& replay) {
@@ -298,17 +308,13 @@ static void ParseWalls(std::ifstream& input, Replay::Data& replay, BSOR::Info co
     int count;
     READ_TO(count);
 
-    auto& notes = replay.events->notes;
     auto& walls = replay.events->walls;
     auto& events = replay.events->events;
 
     BSOR::WallEvent wallEvent;
 
-    // oh boy, I get to calculate the end time of wall events based on energy, it's not like anything better could have been done in the recording phase
-    float energy = 0.5;
     // note that beatleader does not record overlapping wall events
     float latestWallTime = -1;
-    auto note = notes.begin();
 
     for (int i = 0; i < count; i++) {
         auto& wall = walls.emplace_back();
@@ -328,8 +334,10 @@ static void ParseWalls(std::ifstream& input, Replay::Data& replay, BSOR::Info co
         // we don't care about energy or end time in this case
         // theoretically we should use end time to keep playerHeadIsInObstacle accurate, but since the PC version
         // records end energy instead of end time, it's not possible to know the end time on those replays in this case
-        if (replay.info.modifiers.fourLives || replay.info.modifiers.oneLife)
+        if (replay.info.modifiers.fourLives || replay.info.modifiers.oneLife) {
+            wall.endTime = wall.time;
             continue;
+        }
 
         // "oculus" means standalone - PC is either "steam" or "oculuspc"
         if (info.platform == "oculus") {
@@ -338,25 +346,8 @@ static void ParseWalls(std::ifstream& input, Replay::Data& replay, BSOR::Info co
             if (wall.time > latestWallTime)
                 latestWallTime = wall.time;
         } else {
-            // process all note events up to event time
-            while (note != notes.end() && note->time < wallEvent.time) {
-                energy += Utils::EnergyForNote(note->info, replay.events->hasOldScoringTypes);
-                if (energy > 1)
-                    energy = 1;
-                note++;
-            }
-            float diff = energy - wallEvent.energy;
-            // this should never happen
-            if (diff < 0)
-                diff = 0;
-            float seconds = diff / 1.3;
-            wall.endTime = wallEvent.time + seconds;
-            // now we also correct for any cuts that happen during the wall...
-            while (note != notes.end() && note->time < wall.endTime) {
-                wall.endTime += Utils::EnergyForNote(note->info, replay.events->hasOldScoringTypes) / 1.3;
-                note++;
-            }
-            energy = wallEvent.energy;
+            // the end time is calculated from the energy in preprocessing, since it depends on the other events
+            wall.endEnergy = wallEvent.energy;
         }
     }
 
@@ -475,7 +466,7 @@ std::shared_ptr<Replay::Data> Parsing::ReadBSOR(std::string const& path) {
     READ_TO(section);
     if (section != 1)
         throw Exception("Invalid section 1 header");
-    ParsePoses(input, *replay, info.mode.find("Degree") != std::string::npos);
+    ParsePoses(input, *replay, info.mode.find("Degree") != std::string::npos, path);
 
     READ_TO(section);
     if (section != 2)
@@ -502,10 +493,19 @@ std::shared_ptr<Replay::Data> Parsing::ReadBSOR(std::string const& path) {
     // need to do after parsing poses
     replay->info.quit = flags.contains("quit");
     // set so we know that having quit is possible, since older replays won't have the file name
-    replay->info.quitTime = replay->poses.back().time;
+    replay->info.quitTime = replay->poseStream ? replay->poseStream->back().time : replay->poses.back().time;
 
     replay->info.hash = GetFullHash(input);
 
     PreProcess(*replay);
     return replay;
 }
+
+std::shared_ptr<Replay::Data> Parsing::ReadTemporaryBSOR(std::string const& path) {
+    auto replay = ReadBSOR(path);
+    if (replay->poseStream) {
+        replay->poses = replay->poseStream->ReadAll();
+        replay->poseStream.reset();
+    }
+    return replay;
+}
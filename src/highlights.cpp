@@ -0,0 +1,152 @@
+#include "highlights.hpp"
+
+#include "utils.hpp"
+
+using namespace Highlights;
+
+static constexpr float WindowLength = 15;
+static constexpr float LeadIn = 2;
+static constexpr float LeadOut = 1;
+static constexpr int MinNotes = 20;
+
+// rough values where each kind of window becomes worth watching, so their scores can be compared
+static constexpr float StreamNps = 6;
+static constexpr float AccuracyFloor = 0.85;
+static constexpr float LowEnergy = 0.2;
+static constexpr float RecoveredEnergy = 0.3;
+static constexpr int MissCluster = 3;
+
+namespace {
+    struct Entry {
+        float time;
+        int score;
+        int maxScore;
+        bool miss;
+    };
+
+    struct Window {
+        std::deque<Entry> notes;
+        int score = 0;
+        int maxScore = 0;
+        int misses = 0;
+        // increasing energies, for the minimum over the window
+        std::deque<std::pair<float, float>> lowest;
+
+        void Add(Entry const& entry, float energy) {
+            notes.emplace_back(entry);
+            score += entry.score;
+            maxScore += entry.maxScore;
+            misses += entry.miss;
+            while (!lowest.empty() && lowest.back().second >= energy)
+                lowest.pop_back();
+            lowest.emplace_back(entry.time, energy);
+        }
+
+        void Trim(float start) {
+            while (!notes.empty() && notes.front().time < start) {
+                auto const& entry = notes.front();
+                score -= entry.score;
+                maxScore -= entry.maxScore;
+                misses -= entry.miss;
+                notes.pop_front();
+            }
+            while (!lowest.empty() && lowest.front().first < start)
+                lowest.pop_front();
+        }
+    };
+}
+
+static std::pair<float, Kind> ScoreWindow(Window const& window, Replay::Events::Reference const& event, float energy) {
+    int count = window.notes.size();
+    float nps = count / WindowLength;
+    std::pair<float, Kind> best = {0, Kind::Stream};
+    auto Consider = [&best](float score, Kind kind) {
+        if (score > best.first)
+            best = {score, kind};
+    };
+
+    // the combo only covers the whole window if nothing in it broke it
+    if (count >= MinNotes && event.combo >= count)
+        Consider(nps / StreamNps * (event.multiplier == 8 ? 1 : 0.8), Kind::Stream);
+    if (count >= MinNotes && window.maxScore > 0) {
+        float accuracy = window.score / (float) window.maxScore;
+        Consider((accuracy - AccuracyFloor) / (1 - AccuracyFloor) * std::min(nps / (StreamNps / 2), 1.f), Kind::Accuracy);
+    }
+    if (!window.lowest.empty()) {
+        float lowest = window.lowest.front().second;
+        if (lowest <= LowEnergy && energy - lowest >= RecoveredEnergy)
+            Consider((energy - lowest) * 2 + (LowEnergy - lowest) * 2, Kind::Recovery);
+    }
+    if (window.misses >= MissCluster)
+        Consider(window.misses / (float) (MissCluster * 2), Kind::Misses);
+    return best;
+}
+
+std::vector<Clip> Highlights::Find(Replay::Events::Data const& events, float songLength, int count) {
+    bool hasScores = events.scores.total.size() == events.notes.size();
+    std::vector<Clip> candidates;
+    Window window;
+    auto energy = events.energy.begin();
+
+    for (auto const& event : events.events) {
+        if (event.eventType != Replay::Events::Reference::Note)
+            continue;
+        auto const& note = events.notes[event.index];
+        if (note.info.eventType == Replay::Events::NoteInfo::Type::BOMB)
+            continue;
+
+        Entry entry = {event.time, 0, 0, note.info.eventType != Replay::Events::NoteInfo::Type::GOOD};
+        if (hasScores) {
+            entry.score = events.scores.total[event.index];
+            entry.maxScore = events.scores.max[event.index];
+        } else {
+            entry.score = Utils::ScoreForNote(note)[3];
+            entry.maxScore = Utils::ScoreForNote(note, true)[3];
+        }
+
+        // both move forward with the events, so the energy is found without searching
+        while (energy != events.energy.end() && energy->time <= event.time)
+            energy++;
+        float current = energy == events.energy.begin() ? 0.5 : std::prev(energy)->energy;
+
+        window.Trim(event.time - WindowLength);
+        window.Add(entry, current);
+
+        auto [score, kind] = ScoreWindow(window, event, current);
+        if (score > 0)
+            candidates.push_back({event.time - WindowLength, event.time, score, kind});
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](Clip const& a, Clip const& b) { return a.score > b.score; });
+
+    std::vector<Clip> ret;
+    for (auto clip : candidates) {
+        if (ret.size() >= count)
+            break;
+        clip.start = std::max(clip.start - LeadIn, 0.f);
+        clip.end = std::min(clip.end + LeadOut, songLength);
+        bool overlaps = std::any_of(ret.begin(), ret.end(), [&clip](Clip const& other) {
+            return clip.start < other.end && other.start < clip.end;
+        });
+        if (overlaps || clip.end <= clip.start)
+            continue;
+        logger.debug("highlight {:.1f}-{:.1f}: {} ({:.2f})", clip.start, clip.end, GetKindName(clip.kind), clip.score);
+        ret.emplace_back(clip);
+    }
+    logger.debug("found {} highlights from {} candidate windows", ret.size(), candidates.size());
+    return ret;
+}
+
+std::string_view Highlights::GetKindName(Kind kind) {
+    switch (kind) {
+        case Kind::Stream:
+            return "Stream";
+        case Kind::Accuracy:
+            return "Accuracy";
+        case Kind::Recovery:
+            return "Recovery";
+        case Kind::Misses:
+            return "Misses";
+    }
+    return "";
+}
@@ -411,7 +411,7 @@ MAKE_AUTO_HOOK_MATCH(
     bool screenDisplacementEffects
 ) {
     if (Manager::Rendering()) {
-        switch (getConfig().Walls.GetValue()) {
+        switch (Manager::GetReplayConfig().walls) {
             case 1:
                 renderer->sharedMaterial = self->_texturedCoreMaterial;
                 break;
@@ -435,7 +435,7 @@ MAKE_AUTO_HOOK_MATCH(
     BeatSaber::Settings::QualitySettings::ObstacleQuality obstacleQuality
 ) {
     if (Manager::Rendering())
-        renderer->sharedMaterial = getConfig().Walls.GetValue() == 0 ? self->_fakeGlowLWMaterial : self->_fakeGlowTexturedMaterial;
+        renderer->sharedMaterial = Manager::GetReplayConfig().walls == 0 ? self->_fakeGlowLWMaterial : self->_fakeGlowTexturedMaterial;
     else
         ObstacleMaterialSetter_SetFakeGlowMaterial(self, renderer, obstacleQuality);
 }
@@ -444,9 +444,9 @@ MAKE_AUTO_HOOK_MATCH(
 MAKE_AUTO_HOOK_MATCH(ConditionalActivation_Awake, &ConditionalActivation::Awake, void, ConditionalActivation* self) {
     if (Manager::Rendering()) {
         if (self->name == "ObstacleFrame")
-            self->gameObject->active = getConfig().Bloom.GetValue();
+            self->gameObject->active = Manager::GetReplayConfig().bloom;
         else if (self->name == "ObstacleFakeGlow")
-            self->gameObject->active = !getConfig().Bloom.GetValue();
+            self->gameObject->active = !Manager::GetReplayConfig().bloom;
         else
             ConditionalActivation_Awake(self);
     } else
@@ -458,12 +458,12 @@ MAKE_AUTO_HOOK_MATCH(ShockwaveEffect_Start, &ShockwaveEffect::Start, void, Shock
     ShockwaveEffect_Start(self);
 
     if (Manager::Rendering())
-        self->_shockwavePS->main.maxParticles = getConfig().ShockwavesOn.GetValue() ? getConfig().Shockwaves.GetValue() : 0;
+        self->_shockwavePS->main.maxParticles = Manager::GetReplayConfig().shockwaves;
 }
 
 // I think graphics tweaks is what unnecessarily disables the component in addition to the game object
 MAKE_AUTO_HOOK_MATCH(ShockwaveEffect_SpawnShockwave, &ShockwaveEffect::SpawnShockwave, void, ShockwaveEffect* self, UnityEngine::Vector3 pos) {
-    if (getConfig().ShockwavesOn.GetValue() && getConfig().Shockwaves.GetValue() > 0) {
+    if (Manager::GetReplayConfig().shockwaves > 0) {
         self->gameObject->active = true;
         self->enabled = true;
     }
@@ -472,7 +472,7 @@ MAKE_AUTO_HOOK_MATCH(ShockwaveEffect_SpawnShockwave, &ShockwaveEffect::SpawnShoc
 
 // prevent pauses during renders
 MAKE_AUTO_HOOK_MATCH(PauseController_get_canPause, &PauseController::get_canPause, bool, PauseController* self) {
-    return Manager::Rendering() ? getConfig().Pauses.GetValue() : PauseController_get_canPause(self);
+    return Manager::Rendering() ? Manager::GetReplayConfig().pauses : PauseController_get_canPause(self);
 }
 
 // prevent replays ending in pause menu
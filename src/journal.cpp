@@ -0,0 +1,65 @@
+#include "journal.hpp"
+
+#include "main.hpp"
+#include "persist.hpp"
+
+static auto const JournalPath = "/sdcard/replay-tmp-mux.journal";
+
+static float lastRecorded = 0;
+
+void Journal::Start(std::string const& settings, LevelSelection const& level) {
+    Persist::WriteFile(JournalPath, fmt::format("{}\n{}\n", settings, WriteToString(level)));
+    lastRecorded = 0;
+}
+
+void Journal::Record(Mp4::Checkpoint const& checkpoint) {
+    if (checkpoint.time - lastRecorded < SegmentSeconds)
+        return;
+    lastRecorded = checkpoint.time;
+    // one line per checkpoint, so a line cut off by a crash is skipped when loading
+    std::ofstream output(JournalPath, std::ios::app);
+    output << fmt::format(
+        "{} {} {} {} {}\n", checkpoint.offset, checkpoint.sequence, checkpoint.videoTime, checkpoint.audioTime, checkpoint.time
+    );
+}
+
+void Journal::MarkQuit() {
+    std::ofstream output(JournalPath, std::ios::app);
+    output << "quit\n";
+}
+
+std::optional<Journal::Render> Journal::Load() {
+    if (!fileexists(JournalPath))
+        return std::nullopt;
+    std::ifstream input(JournalPath);
+    Render ret;
+    std::string level;
+    if (!std::getline(input, ret.settings) || !std::getline(input, level))
+        return std::nullopt;
+    try {
+        ret.level = ReadFromString<LevelSelection>(level);
+    } catch (std::exception const& e) {
+        logger.error("failed to read render journal: {}", e.what());
+        return std::nullopt;
+    }
+    std::string line;
+    while (std::getline(input, line)) {
+        // a line without its newline was cut off by a crash, even if what's left of it still parses
+        if (input.eof())
+            break;
+        if (line == "quit") {
+            ret.quit = true;
+            continue;
+        }
+        std::istringstream stream(line);
+        Mp4::Checkpoint checkpoint;
+        if (stream >> checkpoint.offset >> checkpoint.sequence >> checkpoint.videoTime >> checkpoint.audioTime >> checkpoint.time)
+            ret.checkpoints.emplace_back(checkpoint);
+    }
+    return ret;
+}
+
+void Journal::Clear() {
+    if (fileexists(JournalPath))
+        std::filesystem::remove(JournalPath);
+}
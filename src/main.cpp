@@ -6,6 +6,11 @@
 #include "custom-types/shared/register.hpp"
 #include "hollywood/shared/hollywood.hpp"
 #include "hooks.hpp"
+#include "journal.hpp"
+#include "manager.hpp"
+#include "parsing.hpp"
+#include "queue.hpp"
+#include "spool.hpp"
 
 using namespace GlobalNamespace;
 
@@ -38,6 +43,8 @@ extern "C" void late_load() {
 
     Hooks::Install();
 
+    Manager::WatchConfig();
+
     if (getConfig().Version.GetValue() == 1) {
         logger.info("Migrating config from v1 to v2");
         getConfig().TextHeight.SetValue(getConfig().TextHeight.GetValue() / 2);
@@ -60,9 +67,29 @@ extern "C" void late_load() {
     if (getConfig().TextHeight.GetValue() < 1)
         getConfig().TextHeight.SetValue(1);
 
-    auto queue = getConfig().RenderQueue.GetValue();
-    if (std::erase_if(queue, [](LevelSelection level) { return level.Temporary; }) > 0)
-        getConfig().RenderQueue.SetValue(queue);
+    Queue::Load();
+    auto queue = Queue::Get();
+    // temporary replays can only be rendered after a restart if they were spooled
+    bool changed = std::erase_if(queue, [](LevelSelection level) { return level.Temporary && !Spool::Contains(level.ReplayHash); }) > 0;
+    // put a render interrupted by a crash back at the front of the queue, where it will resume from its last checkpoint
+    auto journal = Journal::Load();
+    bool available = journal && (!journal->level.Temporary || Spool::Contains(journal->level.ReplayHash));
+    if (available && !journal->quit && !journal->checkpoints.empty()) {
+        auto const& level = journal->level;
+        bool queued = std::any_of(queue.begin(), queue.end(), [&level](LevelSelection const& other) {
+            return other.ID == level.ID && other.ReplayHash == level.ReplayHash && other.Difficulty == level.Difficulty &&
+                   other.Characteristic == level.Characteristic;
+        });
+        if (!queued) {
+            logger.info("Restoring interrupted render of {}", level.ID);
+            queue.insert(queue.begin(), level);
+            changed = true;
+        }
+    }
+    Spool::Prune(queue);
+    Parsing::PruneRecalculations();
+    if (changed)
+        Queue::Replace(std::move(queue));
 
     CModInfo beatleader{.id = "bl"};
     CModInfo scoresaber{.id = "ScoreSaber"};
@@ -1,5 +1,7 @@
 #include "manager.hpp"
 
+#include <future>
+
 #include "CustomTypes/ReplayMenu.hpp"
 #include "GlobalNamespace/BeatmapLevelsModel.hpp"
 #include "GlobalNamespace/MenuLightsManager.hpp"
@@ -14,7 +16,10 @@
 #include "metacore/shared/songs.hpp"
 #include "parsing.hpp"
 #include "pause.hpp"
+#include "persist.hpp"
 #include "playback.hpp"
+#include "queue.hpp"
+#include "spool.hpp"
 #include "utils.hpp"
 
 static bool replaying = false;
@@ -26,23 +31,41 @@ static std::vector<std::pair<std::string, std::shared_ptr<Replay::Data>>> replay
 static std::map<std::string, std::shared_ptr<Replay::Data>> tempReplays;
 static bool local = true;
 
+static constexpr int MaxGhosts = 4;
+
+static std::vector<TimeRange> renderRanges;
+
 static bool hasRotations = false;
 static bool cancelPresentation = false;
 
+static ReplayConfig replayConfig;
+
 std::map<std::string, std::vector<std::function<void(char const*, size_t)>>> Manager::customDataCallbacks;
 
+static std::shared_ptr<Replay::Data> GetTemporaryReplay(LevelSelection const& level) {
+    if (tempReplays.contains(level.ReplayHash))
+        return tempReplays[level.ReplayHash];
+    // the spooled copy may have already been read by the render queue prefetch
+    for (auto& [_, replay] : replays) {
+        if (replay->info.hash == level.ReplayHash)
+            return replay;
+    }
+    return Spool::Load(level.ReplayHash);
+}
+
+// the entry the current render was taken from, or nothing if it wasn't started from the queue
+static std::optional<LevelSelection> queueLevel;
+
 static void SelectFromConfig(int index, bool render) {
     logger.debug("selecting level, render: {}, index: {}", render, index);
 
-    auto queue = getConfig().RenderQueue.GetValue();
+    auto const& queue = Queue::Get();
     if (index >= queue.size() || index < 0)
         return;
     auto level = queue[index];
 
-    if (render) {
-        queue.erase(queue.begin() + index);
-        getConfig().RenderQueue.SetValue(queue);
-    }
+    if (render)
+        Queue::Remove(index);
 
     auto main = MetaCore::Game::GetMainFlowCoordinator();
     auto map = main->_beatmapLevelsModel->GetBeatmapLevel(level.ID);
@@ -58,13 +81,22 @@ static void SelectFromConfig(int index, bool render) {
 
     MetaCore::Songs::SelectLevel({Utils::GetCharacteristic(level.Characteristic), level.Difficulty, level.ID}, pack);
 
-    if (tempReplays.contains(level.ReplayHash))
-        Manager::SetExternalReplay("", tempReplays[level.ReplayHash]);
-    else
+    if (level.Temporary) {
+        auto replay = GetTemporaryReplay(level);
+        if (!replay) {
+            logger.debug("temporary replay {} not found", level.ReplayHash);
+            if (render)
+                SelectFromConfig(index, render);
+            return;
+        }
+        Manager::SetExternalReplay("", replay);
+    } else
         getConfig().LastReplayHash.SetValue(level.ReplayHash);
 
     if (render) {
         Manager::StartReplay(true);
+        renderRanges = level.Ranges;
+        queueLevel = level;
         main->_soloFreePlayFlowCoordinator->StartLevel(nullptr, false);
     } else
         Replay::MenuView::Present();
@@ -74,60 +106,94 @@ void Manager::SelectLevelInConfig(int index) {
     SelectFromConfig(index, false);
 }
 
+// stable, so groups are in the order of their first entries and replays of the same beatmap stay in order
+static void GroupQueue(std::vector<LevelSelection>& levels) {
+    std::map<std::string, int> levelOrder;
+    std::map<std::string, int> beatmapOrder;
+    auto beatmapName = [](LevelSelection const& level) {
+        return fmt::format("{} {} {}", level.ID, level.Characteristic, level.Difficulty);
+    };
+    for (auto const& level : levels) {
+        levelOrder.try_emplace(level.ID, levelOrder.size());
+        beatmapOrder.try_emplace(beatmapName(level), beatmapOrder.size());
+    }
+    std::stable_sort(levels.begin(), levels.end(), [&](LevelSelection const& a, LevelSelection const& b) {
+        return std::pair(levelOrder[a.ID], beatmapOrder[beatmapName(a)]) < std::pair(levelOrder[b.ID], beatmapOrder[beatmapName(b)]);
+    });
+}
+
 void Manager::BeginQueue() {
+    // reorder the saved queue itself, so the settings list and progress text show the order it will render in
+    if (getConfig().GroupQueue.GetValue()) {
+        auto levels = Queue::Get();
+        GroupQueue(levels);
+        Queue::Replace(std::move(levels));
+    }
     SelectFromConfig(0, true);
 }
 
-void Manager::SaveCurrentLevelInConfig() {
-    auto map = MetaCore::Songs::GetSelectedKey();
-    if (!map.IsValid())
-        return;
-    auto const& info = GetCurrentInfo();
-
-    auto levels = getConfig().RenderQueue.GetValue();
-    auto& level = levels.emplace_back();
-
+static LevelSelection GetSelection(GlobalNamespace::BeatmapKey const& map) {
+    auto const& info = Manager::GetCurrentInfo();
+    LevelSelection level;
     level.ID = (std::string) map.levelId;
     level.Difficulty = (int) map.difficulty;
     level.Characteristic = (std::string) map.beatmapCharacteristic->serializedName;
     level.ReplayHash = info.hash;
     level.ReplayDesc = fmt::format("{} {}", info.source, Utils::GetStatusString(info));
-    level.Temporary = !AreReplaysLocal();
-    if (level.Temporary)
+    level.Temporary = !Manager::AreReplaysLocal();
+    return level;
+}
+
+void Manager::SaveCurrentLevelInConfig(std::vector<TimeRange> ranges) {
+    auto map = MetaCore::Songs::GetSelectedKey();
+    if (!map.IsValid())
+        return;
+
+    auto level = GetSelection(map);
+    level.Ranges = std::move(ranges);
+    // only kept in memory if there's no file to copy
+    if (level.Temporary && !Spool::Add(level.ReplayHash, replays[0].first))
         tempReplays[level.ReplayHash] = replays[0].second;
 
-    getConfig().RenderQueue.SetValue(levels);
+    Queue::Add(level);
+}
+
+LevelSelection Manager::GetRenderSelection() {
+    auto level = GetSelection(MetaCore::Songs::GetSelectedKey());
+    level.Ranges = renderRanges;
+    return level;
 }
 
-static std::vector<LevelSelection>::iterator FindCurrentLevel(std::vector<LevelSelection>& levels) {
+static int FindCurrentLevel() {
     auto current = MetaCore::Songs::GetSelectedKey();
     if (!current.IsValid())
-        return levels.end();
-    for (auto level = levels.begin(); level != levels.end(); level++) {
-        if (level->ID == current.levelId && level->Characteristic == current.beatmapCharacteristic->_serializedName &&
-            level->Difficulty == (int) current.difficulty && level->ReplayHash == Manager::GetCurrentInfo().hash)
-            return level;
+        return -1;
+    auto const& levels = Queue::Get();
+    for (int i = 0; i < levels.size(); i++) {
+        auto const& level = levels[i];
+        if (level.ID == current.levelId && level.Characteristic == current.beatmapCharacteristic->_serializedName &&
+            level.Difficulty == (int) current.difficulty && level.ReplayHash == Manager::GetCurrentInfo().hash)
+            return i;
     }
-    return levels.end();
+    return -1;
 }
 
 void Manager::RemoveCurrentLevelFromConfig() {
-    auto levels = getConfig().RenderQueue.GetValue();
-    auto level = FindCurrentLevel(levels);
-    if (level == levels.end())
-        return;
-    levels.erase(level);
-    getConfig().RenderQueue.SetValue(levels);
+    int index = FindCurrentLevel();
+    if (index >= 0)
+        Queue::Remove(index);
 }
 
 bool Manager::IsCurrentLevelInConfig() {
-    auto levels = getConfig().RenderQueue.GetValue();
-    return FindCurrentLevel(levels) != levels.end();
+    auto current = MetaCore::Songs::GetSelectedKey();
+    return current.IsValid() && Queue::Contains(GetSelection(current));
 }
 
 void Manager::ClearLevelsFromConfig() {
-    getConfig().RenderQueue.SetValue({});
+    Queue::Clear();
     tempReplays.clear();
+    if (!Manager::Replaying())
+        Spool::Prune({});
 }
 
 void Manager::SetExternalReplay(std::string path, std::shared_ptr<Replay::Data> replay) {
@@ -160,6 +226,69 @@ int Manager::GetSelectedIndex() {
     return 0;
 }
 
+static void RefreshReplayConfig() {
+    auto& config = getConfig();
+    replayConfig.mode = (CameraMode) config.CamMode.GetValue();
+    replayConfig.smoothing = config.Smoothing.GetValue();
+    replayConfig.correction = config.Correction.GetValue();
+    replayConfig.targetTilt = config.TargetTilt.GetValue();
+    replayConfig.offset = config.Offset.GetValue();
+    replayConfig.fps = config.FPS.GetValue();
+    replayConfig.avatar = config.Avatar.GetValue();
+    replayConfig.moveButton = config.MoveButton.GetValue();
+    replayConfig.travelButton = config.TravelButton.GetValue();
+    replayConfig.travelSpeed = config.TravelSpeed.GetValue();
+    replayConfig.timeButton = config.TimeButton.GetValue();
+    replayConfig.timeSkip = config.TimeSkip.GetValue();
+    replayConfig.speedButton = config.SpeedButton.GetValue();
+    replayConfig.walls = config.Walls.GetValue();
+    replayConfig.bloom = config.Bloom.GetValue();
+    replayConfig.shockwaves = config.ShockwavesOn.GetValue() ? config.Shockwaves.GetValue() : 0;
+    replayConfig.pauses = config.Pauses.GetValue();
+}
+
+// the queue only changes between replays, so it isn't refreshed with the rest
+static void RefreshQueueCounts() {
+    auto const& levels = Queue::Get();
+    auto current = MetaCore::Songs::GetSelectedKey();
+    replayConfig.queued = levels.size();
+    replayConfig.queuedOfLevel = 0;
+    if (!getConfig().GroupQueue.GetValue() || !current.IsValid())
+        return;
+    while (replayConfig.queuedOfLevel < levels.size() && levels[replayConfig.queuedOfLevel].ID == current.levelId)
+        replayConfig.queuedOfLevel++;
+}
+
+void Manager::WatchConfig() {
+    auto refresh = [](auto const&) {
+        RefreshReplayConfig();
+    };
+    auto& config = getConfig();
+    config.CamMode.AddChangeEvent(refresh);
+    config.Smoothing.AddChangeEvent(refresh);
+    config.Correction.AddChangeEvent(refresh);
+    config.TargetTilt.AddChangeEvent(refresh);
+    config.Offset.AddChangeEvent(refresh);
+    config.FPS.AddChangeEvent(refresh);
+    config.Avatar.AddChangeEvent(refresh);
+    config.MoveButton.AddChangeEvent(refresh);
+    config.TravelButton.AddChangeEvent(refresh);
+    config.TravelSpeed.AddChangeEvent(refresh);
+    config.TimeButton.AddChangeEvent(refresh);
+    config.TimeSkip.AddChangeEvent(refresh);
+    config.SpeedButton.AddChangeEvent(refresh);
+    config.Walls.AddChangeEvent(refresh);
+    config.Bloom.AddChangeEvent(refresh);
+    config.ShockwavesOn.AddChangeEvent(refresh);
+    config.Shockwaves.AddChangeEvent(refresh);
+    config.Pauses.AddChangeEvent(refresh);
+    RefreshReplayConfig();
+}
+
+ReplayConfig const& Manager::GetReplayConfig() {
+    return replayConfig;
+}
+
 void Manager::StartReplay(bool render) {
     if (replays.empty())
         return;
@@ -169,10 +298,25 @@ void Manager::StartReplay(bool render) {
 
     replaying = true;
     rendering = render;
+    renderRanges.clear();
+    queueLevel.reset();
     started = false;
     paused = false;
     MetaCore::Game::SetScoreSubmission(MOD_ID, false);
     MetaCore::Input::SetHaptics(MOD_ID, false);
+    RefreshReplayConfig();
+    RefreshQueueCounts();
+
+    // other attempts on the same map only drive extra avatars, so they need to share the coordinate space
+    std::vector<std::shared_ptr<Replay::Data>> ghosts;
+    if (local && getConfig().Ghosts.GetValue()) {
+        int selected = GetSelectedIndex();
+        for (int i = 0; i < replays.size() && ghosts.size() < MaxGhosts; i++) {
+            if (i != selected && replays[i].second->info.positionsAreLocal == replay.info.positionsAreLocal)
+                ghosts.emplace_back(replays[i].second);
+        }
+    }
+    Playback::SetGhosts(std::move(ghosts));
 
     auto copy = customDataCallbacks;
     for (auto const& pair : copy) {
@@ -197,12 +341,36 @@ void Manager::CameraFinished() {
     if (!rendering)
         return;
     MetaCore::Game::SetCameraFadeOut(MOD_ID, false, 0.5);
-    if (!getConfig().RenderQueue.GetValue().empty())
+    // quitting stops the queue instead of moving on to the next render
+    if (MetaCore::Internals::mapWasQuit)
+        logger.info("render quit, stopping the queue");
+    else if (!Queue::Empty())
         SelectFromConfig(0, true);
     else if (getConfig().Ding.GetValue())
         Utils::PlayDing();
 }
 
+void Manager::RequeueRender() {
+    if (!queueLevel)
+        return;
+    auto level = *std::exchange(queueLevel, std::nullopt);
+    // the replay has to be found again even after the selected replays change
+    if (level.Temporary && !tempReplays.contains(level.ReplayHash) && !Spool::Contains(level.ReplayHash))
+        tempReplays[level.ReplayHash] = GetCurrentReplayShared();
+    logger.info("putting quit render of {} back in the queue", level.ID);
+    auto levels = Queue::Get();
+    levels.insert(levels.begin(), std::move(level));
+    Queue::Replace(std::move(levels));
+}
+
+std::vector<TimeRange> const& Manager::GetRenderRanges() {
+    return renderRanges;
+}
+
+std::shared_ptr<Replay::Data> Manager::GetCurrentReplayShared() {
+    return replays[GetSelectedIndex()].second;
+}
+
 Replay::Data& Manager::GetCurrentReplay() {
     return *replays[GetSelectedIndex()].second;
 }
@@ -249,7 +417,100 @@ bool Manager::CancelPresentation() {
     return ret;
 }
 
+// reads the next queued replay while the current one renders, so the level transition doesn't wait on it
+namespace Prefetch {
+    using Replays = std::vector<std::pair<std::string, std::shared_ptr<Replay::Data>>>;
+
+    static LevelSelection level;
+    // every file found, in the order they would be read without prefetching
+    static std::vector<Parsing::ReplayFile> files;
+    static std::shared_future<Replays> replays;
+    static int generation = 0;
+
+    static GlobalNamespace::BeatmapKey GetKey(LevelSelection const& level) {
+        return {Utils::GetCharacteristic(level.Characteristic), level.Difficulty, level.ID};
+    }
+
+    static void PrepareNotes(Replays const& read) {
+        auto key = GetKey(level);
+        auto replay = tempReplays.contains(level.ReplayHash) ? tempReplays[level.ReplayHash] : nullptr;
+        for (auto& [_, data] : read) {
+            if (!replay && data->info.hash == level.ReplayHash)
+                replay = data;
+        }
+        if (!replay)
+            return;
+        MetaCore::Songs::GetBeatmapData(key, [replay, key](GlobalNamespace::IReadonlyBeatmapData* data) {
+            Parsing::PrepareRecalculation(replay, key, data);
+        });
+    }
+
+    static void Start() {
+        replays = {};
+        generation++;
+        if (Queue::Empty())
+            return;
+        level = Queue::Get().front();
+        auto key = GetKey(level);
+        if (!key.IsValid())
+            return;
+        logger.debug("prefetching replays for {}", key.SerializedName());
+
+        // files have to be found on the main thread, but reading them doesn't
+        files = Parsing::FindReplays(key);
+        if (level.Temporary && !tempReplays.contains(level.ReplayHash)) {
+            if (auto path = Spool::GetPath(level.ReplayHash); !path.empty())
+                files.push_back({path, "spooled bsor", Parsing::ReadBSOR});
+        }
+        // the other formats use il2cpp quaternion functions while reading, so only bsors are read on the thread
+        std::vector<Parsing::ReplayFile> background;
+        std::copy_if(files.begin(), files.end(), std::back_inserter(background), [](Parsing::ReplayFile const& file) {
+            return file.read == Parsing::ReadBSOR;
+        });
+        std::promise<Replays> promise;
+        replays = promise.get_future().share();
+        std::thread([promise = std::move(promise), background = std::move(background), id = generation]() mutable {
+            promise.set_value(Parsing::ReadReplays(background));
+            BSML::MainThreadScheduler::Schedule([id]() {
+                // skip if the prefetch was already taken or replaced
+                if (id == generation && replays.valid())
+                    PrepareNotes(replays.get());
+            });
+        }).detach();
+    }
+
+    static std::optional<Replays> Take(GlobalNamespace::BeatmapKey const& map) {
+        if (!replays.valid())
+            return std::nullopt;
+        auto future = std::exchange(replays, {});
+        bool same = level.ID == map.levelId && level.Difficulty == (int) map.difficulty &&
+                    level.Characteristic == map.beatmapCharacteristic->_serializedName;
+        if (!same)
+            return std::nullopt;
+        // read everything now instead of waiting if the thread isn't done
+        if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            logger.debug("prefetch not finished, reading replays directly");
+            return std::nullopt;
+        }
+        logger.debug("using prefetched replays");
+        auto const& read = future.get();
+        Replays ret;
+        for (auto const& file : files) {
+            if (file.read != Parsing::ReadBSOR) {
+                auto rest = Parsing::ReadReplays({file});
+                ret.insert(ret.end(), rest.begin(), rest.end());
+                continue;
+            }
+            auto found = std::find_if(read.begin(), read.end(), [&file](auto const& replay) { return replay.first == file.path; });
+            if (found != read.end())
+                ret.emplace_back(*found);
+        }
+        return ret;
+    }
+}
+
 ON_EVENT(MetaCore::Events::Update) {
+    Persist::Update();
     if (!replaying || paused)
         return;
     Playback::UpdateTime();
@@ -261,7 +522,10 @@ ON_EVENT(MetaCore::Events::MapSelected) {
     if (Replay::MenuView::Presented())  // happens on level end
         return;
     auto map = MetaCore::Songs::GetSelectedKey();
-    replays = Parsing::GetReplays(map);
+    if (auto prefetched = Prefetch::Take(map))
+        replays = std::move(*prefetched);
+    else
+        replays = Parsing::GetReplays(map);
     local = true;
     hasRotations = map.beatmapCharacteristic->_containsRotationEvents;
     Replay::MenuView::CreateShortcut();
@@ -272,9 +536,14 @@ ON_EVENT(MetaCore::Events::MapStarted) {
     if (!replaying)
         return;
     logger.debug("replay started");
-    Parsing::RecalculateNotes(Manager::GetCurrentReplay(), MetaCore::Internals::beatmapData->i___GlobalNamespace__IReadonlyBeatmapData());
+    auto beatmapData = MetaCore::Internals::beatmapData->i___GlobalNamespace__IReadonlyBeatmapData();
+    Parsing::RecalculateNotes(Manager::GetCurrentReplay(), MetaCore::Songs::GetSelectedKey(), beatmapData);
+    Playback::BindNotes(beatmapData);
+    Pause::CreateCheckpoints(Manager::GetCurrentReplay());
     Camera::SetupCamera();
     Camera::CreateReplayText();
+    if (rendering)
+        Prefetch::Start();
     if (paused) {
         Camera::OnPause();
         Pause::OnPause();
@@ -286,6 +555,7 @@ ON_EVENT(MetaCore::Events::MapPaused) {
     if (!replaying)
         return;
     logger.debug("replay paused");
+    Persist::Flush();
     paused = true;
     MetaCore::Input::SetHaptics(MOD_ID, true);
     if (!started)
@@ -320,6 +590,7 @@ ON_EVENT(MetaCore::Events::MapEnded) {
     if (!replaying)
         return;
     logger.debug("replay ended");
+    Persist::Flush();
     Camera::FinishReplay();
     started = false;
     paused = false;
@@ -331,6 +602,7 @@ ON_EVENT(MetaCore::Events::GameplaySceneEnded) {
         return;
 
     logger.debug("replay scene ended");
+    Persist::Flush();
     auto main = MetaCore::Game::GetMainFlowCoordinator();
     if (replaying && !MetaCore::Internals::mapWasQuit)
         BSML::MainThreadScheduler::ScheduleNextFrame([main]() { main->_menuLightsManager->SetColorPreset(main->_defaultLightsPreset, false, 0); });
@@ -0,0 +1,637 @@
+#include "mp4.hpp"
+
+#include <unistd.h>
+
+#include <cstring>
+#include <numeric>
+
+using namespace Mp4;
+
+// the writer only needs the timescale to divide evenly into frames
+static constexpr int FrameDuration = 1000;
+
+static constexpr uint32_t SyncSampleFlags = 0x02000000;
+static constexpr uint32_t NonSyncSampleFlags = 0x01010000;
+
+static void Put8(std::vector<uint8_t>& out, uint8_t value) {
+    out.push_back(value);
+}
+
+static void Put16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+static void Put32(std::vector<uint8_t>& out, uint32_t value) {
+    Put16(out, value >> 16);
+    Put16(out, value);
+}
+
+static void Put64(std::vector<uint8_t>& out, uint64_t value) {
+    Put32(out, value >> 32);
+    Put32(out, value);
+}
+
+static void PutBytes(std::vector<uint8_t>& out, void const* data, size_t size) {
+    out.insert(out.end(), (uint8_t const*) data, (uint8_t const*) data + size);
+}
+
+static void PutZeros(std::vector<uint8_t>& out, size_t count) {
+    out.insert(out.end(), count, 0);
+}
+
+static size_t BeginBox(std::vector<uint8_t>& out, char const* type) {
+    size_t start = out.size();
+    Put32(out, 0);
+    PutBytes(out, type, 4);
+    return start;
+}
+
+static size_t BeginFullBox(std::vector<uint8_t>& out, char const* type, uint8_t version, uint32_t flags) {
+    size_t start = BeginBox(out, type);
+    Put32(out, (version << 24) | (flags & 0xffffff));
+    return start;
+}
+
+static void EndBox(std::vector<uint8_t>& out, size_t start) {
+    uint32_t size = out.size() - start;
+    out[start] = size >> 24;
+    out[start + 1] = size >> 16;
+    out[start + 2] = size >> 8;
+    out[start + 3] = size;
+}
+
+static void PutMatrix(std::vector<uint8_t>& out) {
+    for (uint32_t value : {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000})
+        Put32(out, value);
+}
+
+// calls back with each nal unit, without its start code
+template <class F>
+static void ForEachNal(uint8_t const* data, size_t size, F&& callback) {
+    auto FindStart = [data, size](size_t from) {
+        for (size_t i = from; i + 3 <= size; i++) {
+            if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1)
+                return i;
+        }
+        return size;
+    };
+    size_t start = FindStart(0);
+    while (start < size) {
+        size_t nal = start + 3;
+        size_t next = FindStart(nal);
+        size_t end = next;
+        // four byte start codes leave a trailing zero
+        while (end > nal && data[end - 1] == 0 && next < size)
+            end--;
+        if (end > nal)
+            callback(data + nal, end - nal);
+        start = next;
+    }
+}
+
+static int NalType(uint8_t const* nal, bool hevc) {
+    return hevc ? (nal[0] >> 1) & 0x3f : nal[0] & 0x1f;
+}
+
+static bool IsParameterSet(int type, bool hevc) {
+    return hevc ? type >= 32 && type <= 34 : type == 7 || type == 8;
+}
+
+static bool IsKeyframe(int type, bool hevc) {
+    return hevc ? type >= 16 && type <= 21 : type == 5;
+}
+
+// removes emulation prevention bytes to read fields from a parameter set
+static std::vector<uint8_t> Unescape(std::vector<uint8_t> const& nal) {
+    std::vector<uint8_t> ret;
+    ret.reserve(nal.size());
+    int zeros = 0;
+    for (auto byte : nal) {
+        if (zeros >= 2 && byte == 3) {
+            zeros = 0;
+            continue;
+        }
+        zeros = byte == 0 ? zeros + 1 : 0;
+        ret.push_back(byte);
+    }
+    return ret;
+}
+
+static std::vector<uint8_t> const* FindParameterSet(std::vector<std::vector<uint8_t>> const& sets, int type, bool hevc) {
+    for (auto& set : sets) {
+        if (NalType(set.data(), hevc) == type)
+            return &set;
+    }
+    return nullptr;
+}
+
+static void PutAvcConfig(std::vector<uint8_t>& out, std::vector<std::vector<uint8_t>> const& sets) {
+    auto sps = FindParameterSet(sets, 7, false);
+    auto pps = FindParameterSet(sets, 8, false);
+    if (!sps || !pps || sps->size() < 4)
+        return;
+    size_t box = BeginBox(out, "avcC");
+    Put8(out, 1);
+    PutBytes(out, sps->data() + 1, 3);
+    Put8(out, 0xff);
+    Put8(out, 0xe1);
+    Put16(out, sps->size());
+    PutBytes(out, sps->data(), sps->size());
+    Put8(out, 1);
+    Put16(out, pps->size());
+    PutBytes(out, pps->data(), pps->size());
+    EndBox(out, box);
+}
+
+static void PutHevcConfig(std::vector<uint8_t>& out, std::vector<std::vector<uint8_t>> const& sets) {
+    auto sps = FindParameterSet(sets, 33, true);
+    if (!sps)
+        return;
+    // general profile, tier, and level from the sps, after the nal header and the sub layer byte
+    auto rbsp = Unescape(*sps);
+    if (rbsp.size() < 15)
+        return;
+    size_t box = BeginBox(out, "hvcC");
+    Put8(out, 1);
+    PutBytes(out, rbsp.data() + 3, 12);
+    Put16(out, 0xf000);
+    Put8(out, 0xfc);
+    // 4:2:0 and 8 bit
+    Put8(out, 0xfd);
+    Put8(out, 0xf8);
+    Put8(out, 0xf8);
+    Put16(out, 0);
+    // one temporal layer, nested, four byte lengths
+    Put8(out, 0x0f);
+
+    int arrays = 0;
+    for (int type : {32, 33, 34})
+        arrays += FindParameterSet(sets, type, true) != nullptr;
+    Put8(out, arrays);
+    for (int type : {32, 33, 34}) {
+        auto set = FindParameterSet(sets, type, true);
+        if (!set)
+            continue;
+        Put8(out, 0x80 | type);
+        Put16(out, 1);
+        Put16(out, set->size());
+        PutBytes(out, set->data(), set->size());
+    }
+    EndBox(out, box);
+}
+
+static void PutDataInformation(std::vector<uint8_t>& out) {
+    size_t dinf = BeginBox(out, "dinf");
+    size_t dref = BeginFullBox(out, "dref", 0, 0);
+    Put32(out, 1);
+    EndBox(out, BeginFullBox(out, "url ", 0, 1));
+    EndBox(out, dref);
+    EndBox(out, dinf);
+}
+
+// sample tables are empty since every sample is in the fragments
+static void PutEmptySampleTables(std::vector<uint8_t>& out) {
+    for (auto type : {"stts", "stsc", "stco"}) {
+        size_t box = BeginFullBox(out, type, 0, 0);
+        Put32(out, 0);
+        EndBox(out, box);
+    }
+    size_t stsz = BeginFullBox(out, "stsz", 0, 0);
+    Put32(out, 0);
+    Put32(out, 0);
+    EndBox(out, stsz);
+}
+
+static void PutTrackHeader(std::vector<uint8_t>& out, int track, bool audio, int width, int height) {
+    size_t tkhd = BeginFullBox(out, "tkhd", 0, 3);
+    Put32(out, 0);
+    Put32(out, 0);
+    Put32(out, track);
+    Put32(out, 0);
+    Put32(out, 0);
+    PutZeros(out, 8);
+    Put16(out, 0);
+    Put16(out, 0);
+    Put16(out, audio ? 0x0100 : 0);
+    Put16(out, 0);
+    PutMatrix(out);
+    Put32(out, width << 16);
+    Put32(out, height << 16);
+    EndBox(out, tkhd);
+}
+
+static void PutMediaHeader(std::vector<uint8_t>& out, int timescale, char const* handler, char const* name) {
+    size_t mdhd = BeginFullBox(out, "mdhd", 0, 0);
+    Put32(out, 0);
+    Put32(out, 0);
+    Put32(out, timescale);
+    Put32(out, 0);
+    // undetermined language
+    Put16(out, 0x55c4);
+    Put16(out, 0);
+    EndBox(out, mdhd);
+
+    size_t hdlr = BeginFullBox(out, "hdlr", 0, 0);
+    Put32(out, 0);
+    PutBytes(out, handler, 4);
+    PutZeros(out, 12);
+    PutBytes(out, name, strlen(name) + 1);
+    EndBox(out, hdlr);
+}
+
+Muxer::~Muxer() {
+    StopAudio();
+}
+
+void Muxer::Reset(int width, int height, int fps, bool hevc, int sampleRate, int channels) {
+    this->width = width;
+    this->height = height;
+    this->fps = fps;
+    this->hevc = hevc;
+    this->sampleRate = sampleRate;
+    this->channels = channels;
+    wroteHeader = false;
+    parameterSets.clear();
+    offset = 0;
+    sequence = 0;
+    videoTime = 0;
+    audioTime = 0;
+    videoData.clear();
+    videoSizes.clear();
+    videoSync.clear();
+    audioFrames.clear();
+    audioSizes.clear();
+    audioDurations.clear();
+    flac.emplace(sampleRate, channels);
+    std::unique_lock lock(audioMutex);
+    audioData.clear();
+}
+
+bool Muxer::Open(std::string const& path, int width, int height, int fps, bool hevc, int sampleRate, int channels) {
+    StopAudio();
+    std::unique_lock lock(mutex);
+    if (!output.Open(path))
+        return false;
+    Reset(width, height, fps, hevc, sampleRate, channels);
+    StartAudio();
+    return true;
+}
+
+bool Muxer::Resume(
+    std::string const& path, int width, int height, int fps, bool hevc, int sampleRate, int channels, Checkpoint const& checkpoint
+) {
+    StopAudio();
+    std::unique_lock lock(mutex);
+    if (::truncate(path.c_str(), checkpoint.offset) != 0) {
+        logger.error("failed to truncate {} to resume: {}", path, strerror(errno));
+        return false;
+    }
+    if (!output.Open(path, true))
+        return false;
+    Reset(width, height, fps, hevc, sampleRate, channels);
+    // the header is already in the file, and the encoder starts again with a keyframe
+    wroteHeader = true;
+    offset = checkpoint.offset;
+    sequence = checkpoint.sequence;
+    videoTime = checkpoint.videoTime;
+    audioTime = checkpoint.audioTime;
+    // audio still pending or being encoded at the checkpoint never made it into the file, but the song is seeked
+    // to the video time, so fill the gap with silence to keep the new audio in sync and its frames numbered in order
+    uint64_t videoSamples = videoTime * sampleRate / ((uint64_t) fps * FrameDuration);
+    if (videoSamples > audioTime) {
+        std::unique_lock audioLock(audioMutex);
+        audioData.assign((videoSamples - audioTime) * channels, 0);
+    }
+    StartAudio();
+    logger.info("resuming {} from {:.1f}s", path, checkpoint.time);
+    return true;
+}
+
+void Muxer::Output(void const* data, size_t size) {
+    output.Push(data, size);
+    offset += size;
+}
+
+void Muxer::AddVideo(uint8_t const* data, size_t size) {
+    std::unique_lock lock(mutex);
+    if (!output.IsOpen())
+        return;
+
+    bool sample = false;
+    bool keyframe = false;
+    size_t start = videoData.size();
+    ForEachNal(data, size, [this, &sample, &keyframe](uint8_t const* nal, size_t length) {
+        int type = NalType(nal, hevc);
+        if (IsParameterSet(type, hevc)) {
+            if (!wroteHeader)
+                parameterSets.emplace_back(nal, nal + length);
+            return;
+        }
+        sample = true;
+        keyframe |= IsKeyframe(type, hevc);
+        // mp4 samples use length prefixes instead of start codes
+        Put32(videoData, length);
+        PutBytes(videoData, nal, length);
+    });
+    if (!sample)
+        return;
+
+    // cut before a keyframe once there's enough pending, so fragments can be decoded on their own
+    int pending = videoSizes.size();
+    if (pending > 0 && ((keyframe && pending >= fps * FragmentSeconds) || pending >= fps * FragmentSeconds * 4)) {
+        std::vector<uint8_t> unit(videoData.begin() + start, videoData.end());
+        videoData.resize(start);
+        WriteFragment();
+        PutBytes(videoData, unit.data(), unit.size());
+        start = 0;
+    }
+    videoSizes.push_back(videoData.size() - start);
+    videoSync.push_back(keyframe);
+}
+
+void Muxer::AddAudio(std::span<int16_t const> samples, int channels) {
+    std::unique_lock lock(audioMutex);
+    if (!output.IsOpen() || channels <= 0)
+        return;
+    if (channels == this->channels)
+        audioData.insert(audioData.end(), samples.begin(), samples.end());
+    else {
+        // match the channel count in the header by dropping or repeating channels
+        for (size_t frame = 0; frame + channels <= samples.size(); frame += channels) {
+            for (int channel = 0; channel < this->channels; channel++)
+                audioData.emplace_back(samples[frame + std::min(channel, channels - 1)]);
+        }
+    }
+    if (audioData.size() >= Flac::Encoder::BlockSize * this->channels)
+        audioCondition.notify_one();
+}
+
+void Muxer::Finish() {
+    // the audio thread needs the lock to hand over its last frames
+    StopAudio();
+    std::unique_lock lock(mutex);
+    if (!output.IsOpen())
+        return;
+    WriteFragment();
+    output.Close();
+}
+
+void Muxer::WriteHeader() {
+    box.clear();
+
+    size_t ftyp = BeginBox(box, "ftyp");
+    PutBytes(box, "isom", 4);
+    Put32(box, 0x200);
+    for (auto brand : {"isom", "iso6", "mp41"})
+        PutBytes(box, brand, 4);
+    EndBox(box, ftyp);
+
+    size_t moov = BeginBox(box, "moov");
+
+    size_t mvhd = BeginFullBox(box, "mvhd", 0, 0);
+    Put32(box, 0);
+    Put32(box, 0);
+    Put32(box, 1000);
+    Put32(box, 0);
+    Put32(box, 0x00010000);
+    Put16(box, 0x0100);
+    PutZeros(box, 10);
+    PutMatrix(box);
+    PutZeros(box, 24);
+    Put32(box, 3);
+    EndBox(box, mvhd);
+
+    // video track
+    size_t trak = BeginBox(box, "trak");
+    PutTrackHeader(box, 1, false, width, height);
+    size_t mdia = BeginBox(box, "mdia");
+    PutMediaHeader(box, fps * FrameDuration, "vide", "VideoHandler");
+    size_t minf = BeginBox(box, "minf");
+    size_t vmhd = BeginFullBox(box, "vmhd", 0, 1);
+    PutZeros(box, 8);
+    EndBox(box, vmhd);
+    PutDataInformation(box);
+    size_t stbl = BeginBox(box, "stbl");
+    size_t stsd = BeginFullBox(box, "stsd", 0, 0);
+    Put32(box, 1);
+    size_t entry = BeginBox(box, hevc ? "hvc1" : "avc1");
+    PutZeros(box, 6);
+    Put16(box, 1);
+    PutZeros(box, 16);
+    Put16(box, width);
+    Put16(box, height);
+    Put32(box, 0x00480000);
+    Put32(box, 0x00480000);
+    Put32(box, 0);
+    Put16(box, 1);
+    PutZeros(box, 32);
+    Put16(box, 0x0018);
+    Put16(box, 0xffff);
+    if (hevc)
+        PutHevcConfig(box, parameterSets);
+    else
+        PutAvcConfig(box, parameterSets);
+    EndBox(box, entry);
+    EndBox(box, stsd);
+    PutEmptySampleTables(box);
+    EndBox(box, stbl);
+    EndBox(box, minf);
+    EndBox(box, mdia);
+    EndBox(box, trak);
+
+    // audio track
+    trak = BeginBox(box, "trak");
+    PutTrackHeader(box, 2, true, 0, 0);
+    mdia = BeginBox(box, "mdia");
+    PutMediaHeader(box, sampleRate, "soun", "SoundHandler");
+    minf = BeginBox(box, "minf");
+    size_t smhd = BeginFullBox(box, "smhd", 0, 0);
+    Put32(box, 0);
+    EndBox(box, smhd);
+    PutDataInformation(box);
+    stbl = BeginBox(box, "stbl");
+    stsd = BeginFullBox(box, "stsd", 0, 0);
+    Put32(box, 1);
+    entry = BeginBox(box, "fLaC");
+    PutZeros(box, 6);
+    Put16(box, 1);
+    PutZeros(box, 8);
+    Put16(box, channels);
+    Put16(box, 16);
+    Put32(box, 0);
+    Put32(box, (uint32_t) sampleRate << 16);
+    size_t dfLa = BeginFullBox(box, "dfLa", 0, 0);
+    auto streamInfo = flac->StreamInfo();
+    // only the streaminfo block, marked as the last one
+    Put8(box, 0x80);
+    Put8(box, 0);
+    Put16(box, streamInfo.size());
+    PutBytes(box, streamInfo.data(), streamInfo.size());
+    EndBox(box, dfLa);
+    EndBox(box, entry);
+    EndBox(box, stsd);
+    PutEmptySampleTables(box);
+    EndBox(box, stbl);
+    EndBox(box, minf);
+    EndBox(box, mdia);
+    EndBox(box, trak);
+
+    size_t mvex = BeginBox(box, "mvex");
+    for (int track : {1, 2}) {
+        size_t trex = BeginFullBox(box, "trex", 0, 0);
+        Put32(box, track);
+        Put32(box, 1);
+        Put32(box, track == 1 ? FrameDuration : Flac::Encoder::BlockSize);
+        Put32(box, 0);
+        Put32(box, 0);
+        EndBox(box, trex);
+    }
+    EndBox(box, mvex);
+
+    EndBox(box, moov);
+    Output(box.data(), box.size());
+    wroteHeader = true;
+}
+
+void Muxer::StartAudio() {
+    audioStopping = false;
+    audioThread = std::thread(&Muxer::EncodeAudio, this, (uint32_t) (audioTime / Flac::Encoder::BlockSize));
+}
+
+void Muxer::StopAudio() {
+    if (!audioThread.joinable())
+        return;
+    {
+        std::unique_lock lock(audioMutex);
+        audioStopping = true;
+    }
+    audioCondition.notify_one();
+    audioThread.join();
+}
+
+void Muxer::EncodeAudio(uint32_t frame) {
+    size_t block = Flac::Encoder::BlockSize * channels;
+    std::vector<int16_t> pcm;
+    std::vector<uint8_t> frames;
+    std::vector<uint32_t> sizes;
+    std::vector<uint32_t> durations;
+    while (true) {
+        bool last;
+        {
+            // take whole blocks, or everything left at the end
+            std::unique_lock lock(audioMutex);
+            audioCondition.wait(lock, [this, block]() { return audioStopping || audioData.size() >= block; });
+            last = audioStopping;
+            size_t count = last ? audioData.size() - audioData.size() % channels : audioData.size() - audioData.size() % block;
+            pcm.assign(audioData.begin(), audioData.begin() + count);
+            audioData.erase(audioData.begin(), audioData.begin() + count);
+        }
+        frames.clear();
+        sizes.clear();
+        durations.clear();
+        for (size_t start = 0; start < pcm.size(); start += block) {
+            size_t count = std::min(block, pcm.size() - start);
+            size_t size = frames.size();
+            flac->EncodeFrame(std::span<int16_t const>(pcm.data() + start, count), frame++, frames);
+            sizes.push_back(frames.size() - size);
+            durations.push_back(count / channels);
+        }
+        // only the handover is under the lock, so encoding never holds up the video thread
+        if (!sizes.empty()) {
+            std::unique_lock lock(mutex);
+            PutBytes(audioFrames, frames.data(), frames.size());
+            audioSizes.insert(audioSizes.end(), sizes.begin(), sizes.end());
+            audioDurations.insert(audioDurations.end(), durations.begin(), durations.end());
+        }
+        if (last)
+            return;
+    }
+}
+
+void Muxer::WriteFragment() {
+    if (!wroteHeader)
+        WriteHeader();
+
+    uint64_t audioSamples = std::accumulate(audioDurations.begin(), audioDurations.end(), (uint64_t) 0);
+
+    box.clear();
+    size_t moof = BeginBox(box, "moof");
+    size_t mfhd = BeginFullBox(box, "mfhd", 0, 0);
+    Put32(box, ++sequence);
+    EndBox(box, mfhd);
+
+    // default-base-is-moof, so data offsets are from the start of the moof
+    size_t traf = BeginBox(box, "traf");
+    size_t tfhd = BeginFullBox(box, "tfhd", 0, 0x020000);
+    Put32(box, 1);
+    EndBox(box, tfhd);
+    size_t tfdt = BeginFullBox(box, "tfdt", 1, 0);
+    Put64(box, videoTime);
+    EndBox(box, tfdt);
+    // data offset, sample size, and sample flags present
+    size_t trun = BeginFullBox(box, "trun", 0, 0x000001 | 0x000200 | 0x000400);
+    Put32(box, videoSizes.size());
+    size_t videoOffset = box.size();
+    Put32(box, 0);
+    for (int i = 0; i < videoSizes.size(); i++) {
+        Put32(box, videoSizes[i]);
+        Put32(box, videoSync[i] ? SyncSampleFlags : NonSyncSampleFlags);
+    }
+    EndBox(box, trun);
+    EndBox(box, traf);
+
+    size_t audioOffset = 0;
+    if (!audioSizes.empty()) {
+        traf = BeginBox(box, "traf");
+        tfhd = BeginFullBox(box, "tfhd", 0, 0x020000);
+        Put32(box, 2);
+        EndBox(box, tfhd);
+        tfdt = BeginFullBox(box, "tfdt", 1, 0);
+        Put64(box, audioTime);
+        EndBox(box, tfdt);
+        // data offset, sample duration, and sample size present
+        trun = BeginFullBox(box, "trun", 0, 0x000001 | 0x000100 | 0x000200);
+        Put32(box, audioSizes.size());
+        audioOffset = box.size();
+        Put32(box, 0);
+        for (int i = 0; i < audioSizes.size(); i++) {
+            Put32(box, audioDurations[i]);
+            Put32(box, audioSizes[i]);
+        }
+        EndBox(box, trun);
+        EndBox(box, traf);
+    }
+    EndBox(box, moof);
+
+    uint32_t dataStart = box.size() + 8;
+    for (int i = 0; i < 4; i++)
+        box[videoOffset + i] = dataStart >> (24 - i * 8);
+    if (audioOffset) {
+        uint32_t audioStart = dataStart + videoData.size();
+        for (int i = 0; i < 4; i++)
+            box[audioOffset + i] = audioStart >> (24 - i * 8);
+    }
+
+    size_t mdat = BeginBox(box, "mdat");
+    EndBox(box, mdat);
+    uint32_t mdatSize = 8 + videoData.size() + audioFrames.size();
+    for (int i = 0; i < 4; i++)
+        box[mdat + i] = mdatSize >> (24 - i * 8);
+
+    Output(box.data(), box.size());
+    Output(videoData.data(), videoData.size());
+    Output(audioFrames.data(), audioFrames.size());
+
+    videoTime += videoSizes.size() * FrameDuration;
+    audioTime += audioSamples;
+    videoData.clear();
+    videoSizes.clear();
+    videoSync.clear();
+    audioFrames.clear();
+    audioSizes.clear();
+    audioDurations.clear();
+
+    if (onFragment)
+        onFragment({offset, sequence, videoTime, audioTime, videoTime / (float) (fps * FrameDuration)});
+}
@@ -1,5 +1,6 @@
 #include "parsing.hpp"
 
+#include <future>
 #include <regex>
 
 #include "GlobalNamespace/BeatmapData.hpp"
@@ -9,6 +10,7 @@
 #include "config.hpp"
 #include "md5.hpp"
 #include "metacore/shared/songs.hpp"
+#include "metacore/shared/strings.hpp"
 #include "utils.hpp"
 
 static std::string ReadLength(std::istream& input, int length) {
@@ -101,29 +103,19 @@ static std::string GetSSReplaysPath() {
     return path;
 }
 
-static void GetReqlays(GlobalNamespace::BeatmapKey beatmap, std::vector<std::pair<std::string, std::shared_ptr<Replay::Data>>>& replays) {
-    std::vector<std::string> tests;
-
+static void GetReqlays(GlobalNamespace::BeatmapKey beatmap, std::vector<Parsing::ReplayFile>& files) {
     std::string hash = MetaCore::Songs::GetHash(beatmap);
     std::string diff = std::to_string((int) beatmap.difficulty);
     std::string mode = beatmap.beatmapCharacteristic->compoundIdPartName;
     std::string reqlayName = GetReqlaysPath() + hash + diff + mode;
-    tests.emplace_back(reqlayName + ReqlaySuffix1);
-    tests.emplace_back(reqlayName + ReqlaySuffix2);
     logger.debug("searching for reqlays with name {}", reqlayName);
-    for (auto& path : tests) {
-        try {
-            if (fileexists(path)) {
-                replays.emplace_back(path, Parsing::ReadReqlay(path));
-                logger.info("Read reqlay from {}", path);
-            }
-        } catch (std::exception const& e) {
-            logger.error("Error reading reqlay from {}: {}", path, e.what());
-        }
+    for (auto& suffix : {ReqlaySuffix1, ReqlaySuffix2}) {
+        if (fileexists(reqlayName + suffix))
+            files.push_back({reqlayName + suffix, "reqlay", Parsing::ReadReqlay});
     }
 }
 
-static void GetBSORs(GlobalNamespace::BeatmapKey beatmap, std::vector<std::pair<std::string, std::shared_ptr<Replay::Data>>>& replays) {
+static void GetBSORs(GlobalNamespace::BeatmapKey beatmap, std::vector<Parsing::ReplayFile>& files) {
     std::string diffName = GlobalNamespace::BeatmapDifficultySerializedMethods::SerializedName(beatmap.difficulty);
     if (diffName == "Unknown")
         diffName = "Error";
@@ -139,18 +131,12 @@ static void GetBSORs(GlobalNamespace::BeatmapKey beatmap, std::vector<std::pair<
 
     for (auto const& entry : std::filesystem::directory_iterator(GetBSORsPath())) {
         auto path = entry.path();
-        try {
-            if (!entry.is_directory() && path.extension() == BSORSuffix && path.stem().string().find(search) != std::string::npos) {
-                replays.emplace_back(path.string(), Parsing::ReadBSOR(path.string()));
-                logger.info("Read bsor from {}", path.string());
-            }
-        } catch (std::exception const& e) {
-            logger.error("Error reading bsor from {}: {}", path.string(), e.what());
-        }
+        if (!entry.is_directory() && path.extension() == BSORSuffix && path.stem().string().find(search) != std::string::npos)
+            files.push_back({path.string(), "bsor", Parsing::ReadBSOR});
     }
 }
 
-static void GetSSReplays(GlobalNamespace::BeatmapKey beatmap, std::vector<std::pair<std::string, std::shared_ptr<Replay::Data>>>& replays) {
+static void GetSSReplays(GlobalNamespace::BeatmapKey beatmap, std::vector<Parsing::ReplayFile>& files) {
     std::string diffName = GlobalNamespace::BeatmapDifficultySerializedMethods::SerializedName(beatmap.difficulty);
     std::string characteristic = beatmap.beatmapCharacteristic->serializedName;
     std::string levelHash = beatmap.levelId;
@@ -165,44 +151,56 @@ static void GetSSReplays(GlobalNamespace::BeatmapKey beatmap, std::vector<std::p
 
     for (auto const& entry : std::filesystem::directory_iterator(GetSSReplaysPath())) {
         auto path = entry.path();
-        try {
-            if (!entry.is_directory() && path.extension() == SSSuffix && path.stem().string().ends_with(ending)) {
-                replays.emplace_back(path.string(), Parsing::ReadScoresaber(path.string()));
-                logger.info("Read scoresaber replay from {}", path.string());
-            }
-        } catch (std::exception const& e) {
-            logger.error("Error reading scoresaber replay from {}: {}", path.string(), e.what());
-        }
+        if (!entry.is_directory() && path.extension() == SSSuffix && path.stem().string().ends_with(ending))
+            files.push_back({path.string(), "scoresaber replay", Parsing::ReadScoresaber});
     }
 }
 
-std::vector<std::pair<std::string, std::shared_ptr<Replay::Data>>> Parsing::GetReplays(GlobalNamespace::BeatmapKey beatmap) {
+std::vector<Parsing::ReplayFile> Parsing::FindReplays(GlobalNamespace::BeatmapKey beatmap) {
     if (!beatmap.IsValid())
         return {};
     logger.debug("search replays {}", beatmap.SerializedName());
 
-    std::vector<std::pair<std::string, std::shared_ptr<Replay::Data>>> replays;
+    std::vector<ReplayFile> files;
 
     if (std::filesystem::exists(GetReqlaysPath()))
-        GetReqlays(beatmap, replays);
+        GetReqlays(beatmap, files);
 
     if (std::filesystem::exists(GetBSORsPath()))
-        GetBSORs(beatmap, replays);
+        GetBSORs(beatmap, files);
 
     if (std::filesystem::exists(GetSSReplaysPath()))
-        GetSSReplays(beatmap, replays);
+        GetSSReplays(beatmap, files);
 
+    return files;
+}
+
+std::vector<std::pair<std::string, std::shared_ptr<Replay::Data>>> Parsing::ReadReplays(std::vector<ReplayFile> const& files) {
+    std::vector<std::pair<std::string, std::shared_ptr<Replay::Data>>> replays;
+    for (auto const& file : files) {
+        try {
+            replays.emplace_back(file.path, file.read(file.path));
+            logger.info("Read {} from {}", file.type, file.path);
+        } catch (std::exception const& e) {
+            logger.error("Error reading {} from {}: {}", file.type, file.path, e.what());
+        }
+    }
     return replays;
 }
 
-static int combo;
-static int leftCombo;
-static int rightCombo;
-static int maxCombo;
-static int maxLeftCombo;
-static int maxRightCombo;
-static int multiplier;
-static int multiplierProgress;
+std::vector<std::pair<std::string, std::shared_ptr<Replay::Data>>> Parsing::GetReplays(GlobalNamespace::BeatmapKey beatmap) {
+    return ReadReplays(FindReplays(beatmap));
+}
+
+// per thread, since replays for the render queue are read in the background
+static thread_local int combo;
+static thread_local int leftCombo;
+static thread_local int rightCombo;
+static thread_local int maxCombo;
+static thread_local int maxLeftCombo;
+static thread_local int maxRightCombo;
+static thread_local int multiplier;
+static thread_local int multiplierProgress;
 
 static void ResetTrackers() {
     combo = 0;
@@ -241,6 +239,130 @@ static void BadEvent(bool left, bool right) {
         multiplier /= 2;
 }
 
+static constexpr float WallDrainRate = 1.3;
+
+using EventsIterator = decltype(Replay::Events::Data::events)::iterator;
+
+static thread_local std::vector<Replay::Events::EnergyPoint>* energyCurve;
+static thread_local int lives;
+static thread_local float energy;
+static thread_local float wallDrain;
+static thread_local float drainedTime;
+static thread_local float wallEnd;
+
+static void ResetEnergy(Replay::Data& replay) {
+    lives = 0;
+    if (replay.info.modifiers.oneLife)
+        lives = 1;
+    else if (replay.info.modifiers.fourLives)
+        lives = 4;
+    energy = lives > 0 ? 1 : 0.5;
+    wallDrain = 0;
+    drainedTime = 0;
+    wallEnd = 0;
+    energyCurve = &replay.events->energy;
+    energyCurve->clear();
+    energyCurve->push_back({0, energy, 0});
+}
+
+// applies the energy loss from walls up until a time
+static void DrainEnergy(float time) {
+    float end = std::min(time, wallEnd);
+    if (lives == 0 && end > drainedTime) {
+        float loss = (end - drainedTime) * WallDrainRate;
+        // add a point where it hits zero to keep the curve linear between points
+        if (energy > 0 && loss > energy)
+            energyCurve->push_back({drainedTime + energy / WallDrainRate, 0, wallDrain + energy});
+        energy = std::max(energy - loss, (float) 0);
+        wallDrain += loss;
+        energyCurve->push_back({end, energy, wallDrain});
+    }
+    drainedTime = std::max(drainedTime, time);
+}
+
+static void ReconstructWallEnd(Replay::Events::Data& events, EventsIterator event) {
+    auto& wall = events.walls[event->index];
+    wall.endTime = wall.time + std::max(energy - wall.endEnergy, (float) 0) / WallDrainRate;
+    // the wall lasts longer by however much energy was gained from cuts during it
+    for (auto next = std::next(event); next != events.events.end() && next->time < wall.endTime; next++) {
+        if (next->eventType == Replay::Events::Reference::Note)
+            wall.endTime += events.scores.energy[next->index] / WallDrainRate;
+    }
+}
+
+// runs the energy simulation for one event, also filling in wall end times that weren't recorded
+static void EnergyEvent(Replay::Events::Data& events, EventsIterator event) {
+    DrainEnergy(event->time);
+
+    bool note = event->eventType == Replay::Events::Reference::Note;
+    bool wall = event->eventType == Replay::Events::Reference::Wall;
+    if (!note && !wall)
+        return;
+
+    float previous = energy;
+    if (lives > 0) {
+        if (wall || events.notes[event->index].info.eventType != Replay::Events::NoteInfo::Type::GOOD)
+            energy -= 1 / (float) lives;
+    } else if (wall) {
+        auto& data = events.walls[event->index];
+        if (data.endEnergy >= 0)
+            ReconstructWallEnd(events, event);
+        wallEnd = std::max(wallEnd, data.endTime);
+    } else if (energy > 0)
+        energy += events.scores.energy[event->index];
+
+    energy = std::clamp(energy, (float) 0, (float) 1);
+    if (energy != previous)
+        energyCurve->push_back({event->time, previous, wallDrain});
+    energyCurve->push_back({event->time, energy, wallDrain});
+}
+
+static void SimulateEnergy(Replay::Data& replay) {
+    auto& events = *replay.events;
+    ResetEnergy(replay);
+    for (auto event = events.events.begin(); event != events.events.end(); event++)
+        EnergyEvent(events, event);
+    DrainEnergy(wallEnd);
+}
+
+static constexpr int FrameSearchRadius = 2;
+
+static void CalculateEnergies(Replay::Events::Data& events) {
+    events.scores.energy.resize(events.notes.size());
+    for (int i = 0; i < events.notes.size(); i++)
+        events.scores.energy[i] = Utils::EnergyForNote(events.notes[i].info, events.hasOldScoringTypes);
+}
+
+static void CalculateScores(Replay::Events::Data& events) {
+    auto& scores = events.scores;
+    int count = events.notes.size();
+    scores.pre.assign(count, 0);
+    scores.post.assign(count, 0);
+    scores.acc.assign(count, 0);
+    scores.total.assign(count, 0);
+    scores.max.assign(count, 0);
+
+    for (int i = 0; i < count; i++) {
+        auto const& note = events.notes[i];
+        if (note.info.eventType == Replay::Events::NoteInfo::Type::BOMB)
+            continue;
+        bool fixed = note.info.scoringType == (int) GlobalNamespace::NoteData::ScoringType::ChainLink ||
+                     note.info.scoringType == (int) GlobalNamespace::NoteData::ScoringType::ChainLinkArcHead;
+
+        auto [pre, post, acc, score] = Utils::ScoreForNote(note);
+        auto [maxPre, maxPost, maxAcc, maxScore] = Utils::ScoreForNote(note, true);
+
+        if (maxPost == 0 && !fixed)
+            post = 30;
+
+        scores.pre[i] = pre;
+        scores.post[i] = post;
+        scores.acc[i] = acc;
+        scores.total[i] = score;
+        scores.max[i] = maxScore;
+    }
+}
+
 void Parsing::PreProcess(Replay::Data& replay) {
     if (replay.frames && replay.frames->scores.empty())
         replay.frames.reset();
@@ -278,21 +400,42 @@ void Parsing::PreProcess(Replay::Data& replay) {
                 score.multiplierProgress = multiplierProgress;
             }
         }
+
+        // combo drops are allowed if the combo goes down within a few frames of the current one
+        // the window keeps the existing behavior, where the distance back is negated, so it only covers the first frames
+        int count = frames.scores.size();
+        for (int i = 0; i < count; i++) {
+            auto& score = frames.scores[i];
+            if (score.percent >= 0)
+                score.flags |= Replay::Frames::HasPercent;
+
+            int back = std::min(FrameSearchRadius, -i);
+            int current = i - back;
+            if (back + FrameSearchRadius <= 0 || current >= count)
+                continue;
+            int combo = frames.scores[current].combo;
+            for (int checked = 0; checked < back + FrameSearchRadius && ++current < count;) {
+                int next = frames.scores[current].combo;
+                if (next < 0)
+                    continue;
+                if (next < combo) {
+                    score.flags |= Replay::Frames::ComboDropAllowed;
+                    break;
+                }
+                combo = next;
+                checked++;
+            }
+        }
     }
 
     if (replay.events) {
         auto& events = *replay.events;
         ResetTrackers();
 
-        int lives = 0;
-        if (replay.info.modifiers.oneLife)
-            lives = 1;
-        else if (replay.info.modifiers.fourLives)
-            lives = 4;
+        if (events.scores.energy.size() != events.notes.size())
+            CalculateEnergies(events);
 
-        float wallSegmentStart = 0;
-        float wallSegmentEnd = 0;
-        float energy = lives > 0 ? 1 : 0.5;
+        ResetEnergy(replay);
 
         for (auto event = events.events.begin(); event != events.events.end(); event++) {
             bool note = event->eventType == Replay::Events::Reference::Note;
@@ -307,30 +450,7 @@ void Parsing::PreProcess(Replay::Data& replay) {
             if (wall || note)
                 mistake ? BadEvent(left, right) : GoodEvent(left, right);
 
-            if (lives == 0) {
-                // split up the energy loss from walls if there are events in between
-                if (wallSegmentEnd > 0) {
-                    if (event->time > wallSegmentEnd) {
-                        energy -= (wallSegmentEnd - wallSegmentStart) * 1.3;
-                        wallSegmentEnd = 0;
-                    } else {
-                        energy -= (event->time - wallSegmentStart) * 1.3;
-                        wallSegmentStart = event->time;
-                    }
-                }
-
-                if (wall) {
-                    wallSegmentStart = event->time;
-                    wallSegmentEnd = events.walls[event->index].endTime;
-                } else if (note && energy > 0)
-                    energy += Utils::EnergyForNote(*noteInfo, events.hasOldScoringTypes);
-            } else if (mistake)
-                energy -= 1 / (float) lives;
-
-            if (energy > 1)
-                energy = 1;
-            else if (energy < 0)
-                energy = 0;
+            EnergyEvent(events, event);
 
             // casts are ok because these aren't used when sorting the set
             const_cast<int&>(event->combo) = combo;
@@ -339,10 +459,10 @@ void Parsing::PreProcess(Replay::Data& replay) {
             const_cast<int&>(event->maxCombo) = maxCombo;
             const_cast<int&>(event->maxLeftCombo) = maxLeftCombo;
             const_cast<int&>(event->maxRightCombo) = maxRightCombo;
-            const_cast<float&>(event->energy) = energy;
             const_cast<int&>(event->multiplier) = multiplier;
             const_cast<int&>(event->multiplierProgress) = multiplierProgress;
         }
+        DrainEnergy(wallEnd);
     }
 }
 
@@ -351,44 +471,255 @@ void Parsing::CheckForQuit(Replay::Info& info, float songLength) {
         info.quit = true;
 }
 
-void Parsing::RecalculateNotes(Replay::Data& replay, GlobalNamespace::IReadonlyBeatmapData* beatmapData) {
+static std::vector<Replay::Events::NoteInfo> GetBeatmapNotes(GlobalNamespace::IReadonlyBeatmapData* beatmapData) {
+    std::vector<Replay::Events::NoteInfo> ret;
+    auto list = beatmapData->allBeatmapDataItems;
+    auto item = list->head;
+    while (item) {
+        if (auto noteData = il2cpp_utils::try_cast<GlobalNamespace::NoteData>(item->item).value_or(nullptr))
+            ret.emplace_back(Utils::GetNoteInfo(noteData));
+        item = item->next;
+        if (item == list->head)
+            break;
+    }
+    return ret;
+}
+
+static uint64_t NoteKey(Replay::Events::NoteInfo const& note) {
+    uint64_t ret = (uint16_t) note.lineIndex;
+    ret = (ret << 16) | (uint16_t) note.lineLayer;
+    ret = (ret << 16) | (uint16_t) note.colorType;
+    return (ret << 16) | (uint16_t) note.cutDirection;
+}
+
+// replay note indices with the same key, in order, with the index of the first one that hasn't been matched yet
+struct NoteBucket {
+    int first = 0;
+    std::vector<int> notes;
+};
+
+static std::vector<Replay::Events::NoteInfo> MatchNotes(
+    std::vector<Replay::Events::NoteInfo> notes, std::vector<Replay::Events::NoteInfo> const& beatmapNotes, bool oldScoringTypes, bool checkME
+) {
+    // ME replays can only be matched by the full id, but otherwise the scoring type can't be part of the key because old types can match multiple
+    std::unordered_map<uint64_t, NoteBucket> buckets;
+    for (int i = 0; i < notes.size(); i++)
+        buckets[checkME ? Utils::BSORNoteID(notes[i]) : NoteKey(notes[i])].notes.emplace_back(i);
+    std::vector<bool> matched(notes.size(), false);
+
+    auto firstUnmatched = [&buckets, &matched](uint64_t key) -> NoteBucket* {
+        auto bucket = buckets.find(key);
+        if (bucket == buckets.end())
+            return nullptr;
+        auto& [first, indices] = bucket->second;
+        while (first < indices.size() && matched[indices[first]])
+            first++;
+        return first < indices.size() ? &bucket->second : nullptr;
+    };
+
+    // for each note in the beatmap data, try to find the first note in the replay with a matching id,
+    // then set its info and remove it from the pool (since multiple notes may have the same id)
+    for (auto const& data : beatmapNotes) {
+        int match = -1;
+        if (checkME) {
+            int id = Utils::BSORNoteID(data);
+            for (int candidate : {id, id - 30000}) {
+                if (auto bucket = firstUnmatched(candidate)) {
+                    int index = bucket->notes[bucket->first];
+                    if (match < 0 || index < match)
+                        match = index;
+                }
+            }
+        } else if (auto bucket = firstUnmatched(NoteKey(data))) {
+            for (int i = bucket->first; i < bucket->notes.size(); i++) {
+                int index = bucket->notes[i];
+                if (!matched[index] && Utils::Matches(data, notes[index], oldScoringTypes)) {
+                    match = index;
+                    break;
+                }
+            }
+        }
+        if (match < 0)
+            continue;
+        matched[match] = true;
+        auto eventType = notes[match].eventType;
+        // shouldn't be needed on non-ME recalculation, but might as well
+        notes[match] = data;
+        notes[match].eventType = eventType;
+    }
+    return notes;
+}
+
+static std::vector<Replay::Events::NoteInfo> GetReplayNotes(Replay::Events::Data const& events) {
+    std::vector<Replay::Events::NoteInfo> ret;
+    ret.reserve(events.notes.size());
+    for (auto const& note : events.notes)
+        ret.emplace_back(note.info);
+    return ret;
+}
+
+static std::string const& GetRecalculationsPath() {
+    static auto path = getDataDir(MOD_ID) + "notes/";
+    return path;
+}
+
+static std::string GetRecalculationPath(Replay::Data const& replay, GlobalNamespace::BeatmapKey beatmap) {
+    auto const& path = GetRecalculationsPath();
+    std::string name = MetaCore::Strings::SanitizedPath(fmt::format("{}_{}", replay.info.hash, beatmap.SerializedName()));
+    return path + name + ".dat";
+}
+
+static void SaveRecalculation(std::string const& path, std::vector<Replay::Events::NoteInfo> const& notes) {
+    try {
+        auto parent = std::filesystem::path(path).parent_path();
+        if (!std::filesystem::exists(parent))
+            std::filesystem::create_directories(parent);
+        std::ofstream output(path, std::ios::binary);
+        int count = notes.size();
+        output.write(reinterpret_cast<char const*>(&count), sizeof(int));
+        for (auto const& note : notes) {
+            short values[] = {note.scoringType, note.lineIndex, note.lineLayer, note.colorType, note.cutDirection};
+            output.write(reinterpret_cast<char const*>(values), sizeof(values));
+        }
+        if (!output)
+            throw std::runtime_error(strerror(errno));
+    } catch (std::exception const& e) {
+        logger.error("Failed to save recalculated notes to {}: {}", path, e.what());
+    }
+}
+
+static std::optional<std::vector<Replay::Events::NoteInfo>> LoadRecalculation(std::string const& path, Replay::Events::Data const& events) {
+    if (!fileexists(path))
+        return std::nullopt;
+    std::ifstream input(path, std::ios::binary);
+    int count;
+    input.read(reinterpret_cast<char*>(&count), sizeof(int));
+    if (!input || count != events.notes.size())
+        return std::nullopt;
+
+    auto notes = GetReplayNotes(events);
+    for (auto& note : notes) {
+        short values[5];
+        input.read(reinterpret_cast<char*>(values), sizeof(values));
+        note.scoringType = values[0];
+        note.lineIndex = values[1];
+        note.lineLayer = values[2];
+        note.colorType = values[3];
+        note.cutDirection = values[4];
+    }
+    if (!input)
+        return std::nullopt;
+    // marks it as recently used for pruning
+    try {
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now());
+    } catch (std::exception const& e) {
+        logger.warn("failed to update time of {}: {}", path, e.what());
+    }
+    return notes;
+}
+
+void Parsing::PruneRecalculations() {
+    if (!direxists(GetRecalculationsPath()))
+        return;
+    try {
+        std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::directory_entry>> files;
+        size_t total = 0;
+        for (auto const& entry : std::filesystem::directory_iterator(GetRecalculationsPath())) {
+            if (!entry.is_regular_file())
+                continue;
+            total += entry.file_size();
+            files.emplace_back(entry.last_write_time(), entry);
+        }
+        if (total <= MaxRecalculationsSize)
+            return;
+        // oldest first
+        std::sort(files.begin(), files.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+        int removed = 0;
+        for (auto const& [_, entry] : files) {
+            if (total <= MaxRecalculationsSize)
+                break;
+            total -= entry.file_size();
+            std::filesystem::remove(entry.path());
+            removed++;
+        }
+        logger.info("Removed {} old note recalculations", removed);
+    } catch (std::exception const& e) {
+        logger.error("Failed to prune note recalculations: {}", e.what());
+    }
+}
+
+static std::map<std::string, std::shared_future<std::vector<Replay::Events::NoteInfo>>> pendingRecalculations;
+
+static bool NeedsRecalculation(Replay::Data const& replay) {
+    return replay.events && (replay.events->needsRecalculation || replay.events->hasOldScoringTypes);
+}
+
+void Parsing::PrepareRecalculation(
+    std::shared_ptr<Replay::Data> replay, GlobalNamespace::BeatmapKey beatmap, GlobalNamespace::IReadonlyBeatmapData* beatmapData
+) {
+    if (!replay || !NeedsRecalculation(*replay) || !beatmap.IsValid() || !beatmapData)
+        return;
+    // the menu beatmap data doesn't have the note changes from these modifiers
+    if (replay->info.modifiers.leftHanded || replay->info.modifiers.noArrows)
+        return;
+
+    auto path = GetRecalculationPath(*replay, beatmap);
+    if (pendingRecalculations.contains(path) || fileexists(path))
+        return;
+
+    logger.debug("starting note recalculation for {}", path);
+
+    std::promise<std::vector<Replay::Events::NoteInfo>> promise;
+    pendingRecalculations[path] = promise.get_future().share();
+
+    // the beatmap data is an il2cpp object, so its notes have to be read here, but the replay is kept alive by the thread
+    // the note infos aren't changed until RecalculateNotes has waited for this
+    std::thread([promise = std::move(promise),
+                 path,
+                 replay,
+                 beatmapNotes = GetBeatmapNotes(beatmapData),
+                 oldScoringTypes = replay->events->hasOldScoringTypes,
+                 checkME = replay->events->needsRecalculation]() mutable {
+        auto result = MatchNotes(GetReplayNotes(*replay->events), beatmapNotes, oldScoringTypes, checkME);
+        SaveRecalculation(path, result);
+        promise.set_value(std::move(result));
+    }).detach();
+}
+
+void Parsing::RecalculateNotes(Replay::Data& replay, GlobalNamespace::BeatmapKey beatmap, GlobalNamespace::IReadonlyBeatmapData* beatmapData) {
     if (!replay.events)
         return;
 
     auto& events = *replay.events;
     // needsRecalculation is needed for BeatLeader replays of ME maps that lost data
     // hasOldScoringTypes will also need recalculation in order to get the correct score definitions when doing time seeking
-    if (!events.needsRecalculation && !events.hasOldScoringTypes)
-        return;
-
-    logger.debug("recalculating replay notes with beatmap data");
+    if (NeedsRecalculation(replay)) {
+        auto path = GetRecalculationPath(replay, beatmap);
+
+        std::optional<std::vector<Replay::Events::NoteInfo>> notes;
+        if (auto pending = pendingRecalculations.find(path); pending != pendingRecalculations.end()) {
+            logger.debug("using note recalculation started in menu");
+            notes = pending->second.get();
+            pendingRecalculations.erase(pending);
+        } else if ((notes = LoadRecalculation(path, events)))
+            logger.debug("using saved note recalculation from {}", path);
+        else {
+            logger.debug("recalculating replay notes with beatmap data");
+            notes = MatchNotes(GetReplayNotes(events), GetBeatmapNotes(beatmapData), events.hasOldScoringTypes, events.needsRecalculation);
+            SaveRecalculation(path, *notes);
+        }
 
-    std::list<Replay::Events::Note*> notes;
-    for (auto& note : events.notes)
-        notes.emplace_back(&note);
+        for (int i = 0; i < events.notes.size(); i++)
+            events.notes[i].info = (*notes)[i];
 
-    // for each note in the beatmap data, try to find the first note in the replay with a matching id,
-    // then set its info and remove it from the pool (since multiple notes may have the same id)
-    auto list = beatmapData->allBeatmapDataItems;
-    for (auto i = list->head; i->next != list->head; i = i->next) {
-        auto noteData = il2cpp_utils::try_cast<GlobalNamespace::NoteData>(i->item).value_or(nullptr);
-        if (!noteData)
-            continue;
-        auto iter = std::find_if(notes.begin(), notes.end(), [&events, noteData](auto note) {
-            return Utils::Matches(noteData, note->info, events.hasOldScoringTypes, events.needsRecalculation);
-        });
-        if (iter != notes.end()) {
-            auto& info = (*iter)->info;
-            info.scoringType = (int) noteData->scoringType;
-            // shouldn't be needed on non-ME recalculation, but might as well
-            info.lineIndex = noteData->lineIndex;
-            info.lineLayer = (int) noteData->noteLineLayer;
-            info.colorType = (int) noteData->colorType;
-            info.cutDirection = (int) noteData->cutDirection;
-            notes.erase(iter);
-        }
+        events.needsRecalculation = false;
+        events.hasOldScoringTypes = false;
+        CalculateEnergies(events);
+        SimulateEnergy(replay);
+        events.scores.total.clear();
     }
 
-    events.needsRecalculation = false;
-    events.hasOldScoringTypes = false;
+    // scores need the correct scoring types, so they can't be calculated until now
+    if (events.scores.total.size() != events.notes.size())
+        CalculateScores(events);
 }
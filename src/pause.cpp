@@ -35,6 +35,7 @@
 #include "UnityEngine/Resources.hpp"
 #include "UnityEngine/Shader.hpp"
 #include "UnityEngine/Time.hpp"
+#include "bsml/shared/BSML/MainThreadScheduler.hpp"
 #include "config.hpp"
 #include "manager.hpp"
 #include "metacore/shared/events.hpp"
@@ -43,6 +44,7 @@
 #include "metacore/shared/stats.hpp"
 #include "metacore/shared/strings.hpp"
 #include "metacore/shared/unity.hpp"
+#include "persist.hpp"
 #include "playback.hpp"
 #include "utils.hpp"
 
@@ -59,6 +61,11 @@ static BSML::SliderSetting* timeSlider;
 static BSML::SliderSetting* speedSlider;
 
 static bool inSeek = false;
+static bool scrubbing = false;
+static bool scrubScheduled = false;
+static std::optional<float> scrubTarget;
+static float lastScrubTime = 0;
+static constexpr float ScrubReleaseDelay = 0.15;
 static bool skipDown = false;
 static bool speedDown = false;
 
@@ -77,8 +84,8 @@ static void SetThirdPersonToCameraModel() {
     // model points upwards
     auto offset = Quaternion::AngleAxis(-90, {1, 0, 0});
     rot = rot * offset;
-    getConfig().ThirdPerRot.SetValue(rot.eulerAngles);
-    getConfig().ThirdPerPos.SetValue(cameraModel->transform->position);
+    Persist::Set(getConfig().ThirdPerRot, rot.eulerAngles);
+    Persist::Set(getConfig().ThirdPerPos, cameraModel->transform->position);
 }
 
 static UnityEngine::GameObject*
@@ -117,7 +124,7 @@ static void UpdateCameraActive() {
     if (!inited)
         return;
     SetCameraModelToThirdPerson();
-    cameraModel->active = !Manager::Rendering() && Manager::Paused() && getConfig().CamMode.GetValue() == (int) CameraMode::ThirdPerson;
+    cameraModel->active = !Manager::Rendering() && Manager::Paused() && Manager::GetReplayConfig().mode == CameraMode::ThirdPerson;
 }
 
 static BSML::SliderSetting* TextlessSlider(
@@ -155,6 +162,8 @@ static void SetTransform(BSML::Lite::TransformWrapper obj, UnityEngine::Vector2
     transform->sizeDelta = sizeDelta;
 }
 
+static void ScrubTime(float value);
+
 static void CreateUI() {
     auto parent = BSML::Lite::CreateCanvas();
     parent->AddComponent<HMUI::Screen*>();
@@ -176,7 +185,7 @@ static void CreateUI() {
     if (endTime < startTime + 1)
         endTime = startTime + 1;
 
-    timeSlider = TextlessSlider(parent, startTime, endTime, startTime, (endTime - startTime) / 1000, Pause::SetTime, [](float time) {
+    timeSlider = TextlessSlider(parent, startTime, endTime, startTime, (endTime - startTime) / 1000, ScrubTime, [](float time) {
         return MetaCore::Strings::SecondsToString(time);
     });
     SetTransform(timeSlider, {0, 6}, {100, 10});
@@ -240,6 +249,10 @@ void Pause::OnPause() {
 void Pause::OnUnpause() {
     if (!inited)
         return;
+    // previews only apply while paused
+    scrubTarget.reset();
+    if (scrubbing)
+        SetTime(MetaCore::Stats::GetSongTime());
     cameraModel->active = false;
     SetThirdPersonToCameraModel();
     MetaCore::Internals::audioTimeSyncController->_inBetweenDSPBufferingTimeEstimate = 0;
@@ -285,17 +298,55 @@ static bool ShouldCountNote(Replay::Events::NoteInfo const& note) {
            note.scoringType == (int) GlobalNamespace::NoteData::ScoringType::ChainHeadArcTail;
 }
 
-#define MODIFY(var, num) \
-    var += forwards ? (num) : -(num)
-
-#define SIDED_MOD_1(post, num) \
-    MODIFY((left ? MetaCore::Internals::left##post : MetaCore::Internals::right##post), num)
-
-#define SIDED_MOD_2(pre, post, num) \
-    MODIFY((left ? MetaCore::Internals::pre##Left##post : MetaCore::Internals::pre##Right##post), num)
+// counter changes accumulated over events from the start of the replay, for one saber
+struct SaberCounters {
+    int notes = 0;
+    int bombsHit = 0;
+    int badCuts = 0;
+    int misses = 0;
+    int cuts = 0;
+    int uncountedCuts = 0;
+    decltype(MetaCore::Internals::leftPreSwing) preSwing = 0;
+    decltype(MetaCore::Internals::leftPostSwing) postSwing = 0;
+    decltype(MetaCore::Internals::leftAccuracy) accuracy = 0;
+    decltype(MetaCore::Internals::leftTimeDependence) timeDependence = 0;
+    decltype(MetaCore::Internals::leftScore) score = 0;
+    decltype(MetaCore::Internals::leftMaxScore) maxScore = 0;
+    decltype(MetaCore::Internals::leftMissedFixedScore) missedFixedScore = 0;
+    decltype(MetaCore::Internals::leftMissedMaxScore) missedMaxScore = 0;
+};
+
+struct Counters {
+    SaberCounters left;
+    SaberCounters right;
+    int wallsHit = 0;
+    // notes the game ramps the max multiplier for, which unlike the counted notes includes chain links
+    int multiplierNotes = 0;
+};
+
+// counters accumulated over all events before a given one, stored every few events
+struct Checkpoint {
+    EventsIterator event;
+    Counters counters;
+};
+
+static constexpr int CheckpointInterval = 64;
+static std::vector<Checkpoint> checkpoints;
+
+// the game uses the multipliers from after the cut, and we calculate it based on the notes cut (and missed etc)
+static int MaxMultiplierForNotes(int notes) {
+    if (notes >= 14)
+        return 8;
+    if (notes >= 6)
+        return 4;
+    if (notes >= 2)
+        return 2;
+    return 1;
+}
 
-static void CalculateNoteChanges(Replay::Events::Data& events, EventsIterator event, bool forwards) {
-    auto& note = events.notes[event->index];
+static void AddNote(Counters& counters, Replay::Events::Data const& events, Replay::Events::Reference const& event) {
+    auto& note = events.notes[event.index];
+    auto const& scores = events.scores;
 
     bool left = Utils::IsLeft(note, events.hasBombCutInfo);
     bool mistake = note.info.eventType != Replay::Events::NoteInfo::Type::GOOD;
@@ -303,56 +354,123 @@ static void CalculateNoteChanges(Replay::Events::Data& events, EventsIterator ev
                  note.info.scoringType == (int) GlobalNamespace::NoteData::ScoringType::ChainLinkArcHead;
     bool count = ShouldCountNote(note.info);
 
-    auto [pre, post, acc, score] = Utils::ScoreForNote(note);
-    auto [maxPre, maxPost, maxAcc, maxScore] = Utils::ScoreForNote(note, true);
-
-    // chains are set to full post swing for average calculations
-    if (maxPost == 0 && !fixed)
-        post = 30;
+    int score = scores.total[event.index];
+    int maxScore = scores.max[event.index];
 
-    int mult = event->multiplier;
-    int maxMult = MetaCore::Stats::GetMaxMultiplier();
+    auto& saber = left ? counters.left : counters.right;
 
     if (count)
-        SIDED_MOD_2(remainingNotes, , -1);
+        saber.notes++;
+    if (note.info.eventType != Replay::Events::NoteInfo::Type::BOMB)
+        counters.multiplierNotes++;
 
     if (note.info.eventType == Replay::Events::NoteInfo::Type::BOMB)
-        SIDED_MOD_2(bombs, Hit, 1);
+        saber.bombsHit++;
     else if (note.info.eventType == Replay::Events::NoteInfo::Type::BAD)
-        SIDED_MOD_2(notes, BadCut, 1);
+        saber.badCuts++;
     else if (note.info.eventType == Replay::Events::NoteInfo::Type::MISS)
-        SIDED_MOD_2(notes, Missed, 1);
+        saber.misses++;
     else if (count) {
-        SIDED_MOD_2(notes, Cut, 1);
-        SIDED_MOD_1(PreSwing, pre);
-        SIDED_MOD_1(PostSwing, post);
-        SIDED_MOD_1(Accuracy, acc);
-        SIDED_MOD_1(TimeDependence, std::abs(note.noteCutInfo.cutNormal.z));
+        saber.cuts++;
+        saber.preSwing += scores.pre[event.index];
+        saber.postSwing += scores.post[event.index];
+        saber.accuracy += scores.acc[event.index];
+        saber.timeDependence += std::abs(note.noteCutInfo.cutNormal.z);
     } else
-        SIDED_MOD_2(uncountedNotes, Cut, 1);
+        saber.uncountedCuts++;
 
-    // the game uses the multipliers from after the cut, and we calculate it based on the notes cut (and missed etc)
-    if (forwards)
-        maxMult = MetaCore::Stats::GetMaxMultiplier();
+    int mult = event.multiplier;
+    int maxMult = MaxMultiplierForNotes(counters.multiplierNotes);
 
-    SIDED_MOD_1(Score, score * mult);
-    SIDED_MOD_1(MaxScore, maxScore * maxMult);
+    saber.score += score * mult;
+    saber.maxScore += maxScore * maxMult;
     if (mistake) {
         if (fixed)
-            SIDED_MOD_1(MissedFixedScore, maxScore * maxMult);
+            saber.missedFixedScore += maxScore * maxMult;
         else
-            SIDED_MOD_1(MissedMaxScore, maxScore * maxMult);
+            saber.missedMaxScore += maxScore * maxMult;
     } else
-        SIDED_MOD_1(MissedFixedScore, score * maxMult - score * mult);
+        saber.missedFixedScore += score * maxMult - score * mult;
+}
+
+static void AddEvent(Counters& counters, Replay::Events::Data const& events, Replay::Events::Reference const& event) {
+    switch (event.eventType) {
+        case Replay::Events::Reference::Note:
+            AddNote(counters, events, event);
+            break;
+        case Replay::Events::Reference::Wall:
+            counters.wallsHit++;
+            break;
+        default:
+            break;
+    }
 }
 
-static void CalculateWallChanges(Replay::Events::Wall const& event, bool forwards) {
-    MODIFY(MetaCore::Internals::wallsHit, 1);
+void Pause::CreateCheckpoints(Replay::Data& replay) {
+    checkpoints.clear();
+    if (!replay.events)
+        return;
+
+    auto& events = *replay.events;
+    Counters counters;
+    int index = 0;
+    for (auto event = events.events.begin(); event != events.events.end(); event++, index++) {
+        if (index % CheckpointInterval == 0)
+            checkpoints.push_back({event, counters});
+        AddEvent(counters, events, *event);
+    }
+    logger.debug("created {} seeking checkpoints for {} events", checkpoints.size(), index);
+}
+
+// the counters from all events before the given time
+static Counters CountersAtTime(Replay::Events::Data const& events, float time) {
+    auto checkpoint = std::lower_bound(checkpoints.begin(), checkpoints.end(), time, [](Checkpoint const& checkpoint, float time) {
+        return checkpoint.event->time < time;
+    });
+    if (checkpoint == checkpoints.begin())
+        return {};
+    checkpoint--;
+
+    Counters counters = checkpoint->counters;
+    for (auto event = checkpoint->event; event != events.events.end() && event->time < time; event++)
+        AddEvent(counters, events, *event);
+    return counters;
+}
+
+#define CHANGE(var, field) \
+    MetaCore::Internals::var += to.field - from.field
+
+#define SIDED_CHANGE_1(post, field)   \
+    CHANGE(left##post, left.field); \
+    CHANGE(right##post, right.field)
+
+#define SIDED_CHANGE_2(pre, post, field)      \
+    CHANGE(pre##Left##post, left.field); \
+    CHANGE(pre##Right##post, right.field)
+
+static void ApplyChanges(Counters const& from, Counters const& to) {
+    MetaCore::Internals::remainingNotesLeft -= to.left.notes - from.left.notes;
+    MetaCore::Internals::remainingNotesRight -= to.right.notes - from.right.notes;
+
+    SIDED_CHANGE_2(bombs, Hit, bombsHit);
+    SIDED_CHANGE_2(notes, BadCut, badCuts);
+    SIDED_CHANGE_2(notes, Missed, misses);
+    SIDED_CHANGE_2(notes, Cut, cuts);
+    SIDED_CHANGE_2(uncountedNotes, Cut, uncountedCuts);
+    SIDED_CHANGE_1(PreSwing, preSwing);
+    SIDED_CHANGE_1(PostSwing, postSwing);
+    SIDED_CHANGE_1(Accuracy, accuracy);
+    SIDED_CHANGE_1(TimeDependence, timeDependence);
+    SIDED_CHANGE_1(Score, score);
+    SIDED_CHANGE_1(MaxScore, maxScore);
+    SIDED_CHANGE_1(MissedFixedScore, missedFixedScore);
+    SIDED_CHANGE_1(MissedMaxScore, missedMaxScore);
+
+    CHANGE(wallsHit, wallsHit);
 }
 
 static void CalculateEventChanges(Replay::Data& replay, float time) {
     float current = MetaCore::Stats::GetSongTime();
-    bool forwards = time > current;
 
     bool hadFailed = MetaCore::Internals::health == 0;
 
@@ -363,21 +481,7 @@ static void CalculateEventChanges(Replay::Data& replay, float time) {
     if (event == stop)
         return;
 
-    while (event != stop) {
-        // if going forwards, we want to stop before the next event to be processed,
-        // but for going backwards, we want to include it in the calculations
-        auto next = forwards ? event++ : --event;
-        switch (next->eventType) {
-            case Replay::Events::Reference::Note:
-                CalculateNoteChanges(events, next, forwards);
-                break;
-            case Replay::Events::Reference::Wall:
-                CalculateWallChanges(events.walls[next->index], forwards);
-                break;
-            default:
-                break;
-        }
-    }
+    ApplyChanges(CountersAtTime(events, current), CountersAtTime(events, time));
 
     // since stop is the next event to be processed whether forwards or backwards, we want to set these values to the "current" event instead
     if (stop != events.events.begin())
@@ -395,8 +499,6 @@ static void CalculateEventChanges(Replay::Data& replay, float time) {
 
         MetaCore::Internals::multiplier = stop->multiplier;
         MetaCore::Internals::multiplierProgress = stop->multiplierProgress;
-
-        MetaCore::Internals::health = stop->energy;
     } else {
         // the first event will often be the first cut, and therefore will have the values from after it
         MetaCore::Internals::combo = 0;
@@ -409,10 +511,10 @@ static void CalculateEventChanges(Replay::Data& replay, float time) {
 
         MetaCore::Internals::multiplier = 1;
         MetaCore::Internals::multiplierProgress = 0;
-
-        MetaCore::Internals::health = replay.info.modifiers.oneLife || replay.info.modifiers.fourLives ? 1 : 0.5;
     }
 
+    MetaCore::Internals::health = Utils::SampleEnergy(events.energy, time).energy;
+
     bool nowFailed = MetaCore::Internals::health == 0;
 
     if (MetaCore::Internals::noFail) {
@@ -564,17 +666,15 @@ static void UpdateBaseGameState() {
     comboPanel->_fullComboLost = !full;
 }
 
-void Pause::SetTime(float value) {
-    if (!Manager::Replaying() || MetaCore::Stats::GetSongTime() == value || !LazyInit())
-        return;
-
-    logger.info("Setting replay time to {}", value);
+static void SeekTo(float value, bool preview) {
+    logger.info("Setting replay time to {}, preview: {}", value, preview);
     inSeek = true;
 
     // I don't fully understand it, but there is some weirdness with the score calculation if any elements are left unfinished
     // this function is *probably* unnecessary, since the custom saber movement data finishes everything within the frame,
     // but I'm going to leave it here just to be safe (even though without the custom movement this function doesn't fix it)
-    FinishScoringElements();
+    if (!scrubbing)
+        FinishScoringElements();
 
     auto& replay = Manager::GetCurrentReplay();
 
@@ -588,7 +688,8 @@ void Pause::SetTime(float value) {
     MetaCore::Internals::songTime = value;
 
     // would be extra cool if I could do lighting, but man that seems annoying, especially backwards
-    UpdateBaseGameState();
+    if (!preview)
+        UpdateBaseGameState();
 
     // technically not all guaranteed to have happened, but the idea is just to make stuff update
     MetaCore::Events::Broadcast(MetaCore::Events::ScoreChanged);
@@ -601,13 +702,66 @@ void Pause::SetTime(float value) {
     inSeek = false;
 }
 
+static void UpdateScrub() {
+    scrubScheduled = false;
+    if (!inited || !Manager::Replaying() || !Manager::Paused()) {
+        scrubTarget.reset();
+        scrubbing = false;
+        return;
+    }
+
+    if (scrubTarget) {
+        float value = *scrubTarget;
+        scrubTarget.reset();
+        if (MetaCore::Stats::GetSongTime() != value) {
+            SeekTo(value, true);
+            scrubbing = true;
+        }
+    }
+
+    // the slider doesn't tell us when it's released, so do the full seek once it stops changing
+    if (UnityEngine::Time::get_realtimeSinceStartup() - lastScrubTime >= ScrubReleaseDelay) {
+        if (scrubbing)
+            Pause::SetTime(MetaCore::Stats::GetSongTime());
+        return;
+    }
+    scrubScheduled = true;
+    BSML::MainThreadScheduler::ScheduleNextFrame(UpdateScrub);
+}
+
+static void ScrubTime(float value) {
+    if (!Manager::Replaying() || !LazyInit())
+        return;
+    // only preview the latest value once per frame while the slider is being moved
+    scrubTarget = value;
+    lastScrubTime = UnityEngine::Time::get_realtimeSinceStartup();
+    if (scrubScheduled)
+        return;
+    scrubScheduled = true;
+    BSML::MainThreadScheduler::ScheduleNextFrame(UpdateScrub);
+}
+
+void Pause::SetTime(float value) {
+    if (!Manager::Replaying() || !LazyInit())
+        return;
+    // a full seek is still needed after previews, even if the time is the same
+    if (MetaCore::Stats::GetSongTime() == value && !scrubbing)
+        return;
+
+    scrubTarget.reset();
+    // cleared first so the full seek finishes the scoring elements left by the previews
+    scrubbing = false;
+    SeekTo(value, false);
+}
+
 void Pause::UpdateInputs() {
-    int skip = Utils::IsButtonDown(getConfig().TimeButton.GetValue());
+    auto& config = Manager::GetReplayConfig();
+    int skip = Utils::IsButtonDown(config.timeButton);
     if (skip && !skipDown)
-        SetTime(MetaCore::Stats::GetSongTime() + getConfig().TimeSkip.GetValue() * skip);
+        SetTime(MetaCore::Stats::GetSongTime() + config.timeSkip * skip);
     skipDown = skip != 0;
 
-    int speed = Utils::IsButtonDown(getConfig().SpeedButton.GetValue());
+    int speed = Utils::IsButtonDown(config.speedButton);
     if (speed && !speedDown)
         SetSpeed(MetaCore::Internals::audioTimeSyncController->_timeScale + speed * 0.05);
     speedDown = speed != 0;
@@ -0,0 +1,58 @@
+#include "persist.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "main.hpp"
+
+static std::map<void const*, std::function<void()>> pending;
+static std::chrono::steady_clock::time_point lastChange;
+
+void Persist::MarkDirty(void const* key, std::function<void()> save) {
+    pending[key] = std::move(save);
+    lastChange = std::chrono::steady_clock::now();
+}
+
+void Persist::Flush() {
+    if (pending.empty())
+        return;
+    logger.debug("saving {} pending config values", pending.size());
+    auto saves = std::move(pending);
+    pending.clear();
+    for (auto& [_, save] : saves)
+        save();
+}
+
+void Persist::Update() {
+    if (!pending.empty() && std::chrono::steady_clock::now() - lastChange > std::chrono::duration<float>(SaveDelay))
+        Flush();
+}
+
+bool Persist::WriteFile(std::string const& path, std::string_view data) {
+    auto temp = path + ".tmp";
+    int file = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) {
+        logger.error("failed to open {}: {}", temp, strerror(errno));
+        return false;
+    }
+    size_t written = 0;
+    while (written < data.size()) {
+        auto ret = ::write(file, data.data() + written, data.size() - written);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            logger.error("failed to write {}: {}", temp, strerror(errno));
+            ::close(file);
+            return false;
+        }
+        written += ret;
+    }
+    // make sure the data is on disk before the rename can be
+    ::fsync(file);
+    ::close(file);
+    if (::rename(temp.c_str(), path.c_str()) != 0) {
+        logger.error("failed to replace {}: {}", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
@@ -1,5 +1,6 @@
 #include "playback.hpp"
 
+#include "GlobalNamespace/BeatmapDataItem.hpp"
 #include "GlobalNamespace/GameplayModifiersModelSO.hpp"
 #include "GlobalNamespace/PauseController.hpp"
 #include "GlobalNamespace/PlayerHeadAndObstacleInteraction.hpp"
@@ -9,6 +10,8 @@
 #include "System/Action.hpp"
 #include "System/Action_1.hpp"
 #include "System/Action_2.hpp"
+#include "System/Collections/Generic/LinkedListNode_1.hpp"
+#include "System/Collections/Generic/LinkedList_1.hpp"
 #include "Unity/Mathematics/float3.hpp"
 #include "UnityEngine/Time.hpp"
 #include "UnityEngine/Transform.hpp"
@@ -16,6 +19,7 @@
 #include "metacore/shared/events.hpp"
 #include "metacore/shared/internals.hpp"
 #include "metacore/shared/stats.hpp"
+#include "poses.hpp"
 #include "utils.hpp"
 
 using namespace GlobalNamespace;
@@ -29,7 +33,6 @@ struct NoteComparer {
 };
 
 namespace Frames {
-    static constexpr int frameSearchRadius = 2;
     static Replay::Frames::Data const* frames;
     static decltype(frames->scores)::const_iterator score;
     static float lastCutTime;
@@ -47,32 +50,20 @@ namespace Frames {
         if (!frames)
             return;
         score = std::lower_bound(frames->scores.begin(), frames->scores.end(), time, Replay::TimeSearcher<Replay::Frames::Score>());
+        if (score == frames->scores.end())
+            score--;
     }
 
     static bool AllowComboDrop() {
         if (!frames || Manager::Paused())
             return true;
-        int back = std::min(frameSearchRadius, (int) std::distance(score, frames->scores.begin()));
-        auto iter = score - back;
-        int combo = iter->combo;
-        for (int i = 0; i < back + frameSearchRadius; i++) {
-            iter++;
-            if (iter == frames->scores.end())
-                break;
-            if (iter->combo < 0)
-                i--;
-            else if (iter->combo < combo)
-                return true;
-            else
-                combo = iter->combo;
-        }
-        return false;
+        return score->flags & Replay::Frames::ComboDropAllowed;
     }
 
     static bool AllowScoreOverride() {
         if (!frames || Manager::Paused())
             return false;
-        if (score->percent >= 0)
+        if (score->flags & Replay::Frames::HasPercent)
             return true;
         // fix scoresaber replays having incorrect max score before cut finishes (from the original play)
         return MetaCore::Stats::GetSongTime() - lastCutTime > 0.4;
@@ -93,11 +84,17 @@ namespace Frames {
 }
 
 namespace Events {
-    static std::set<NoteController*, NoteComparer> notes;
+    static constexpr float bindWindow = 2;
     static Replay::Events::Data const* events;
     static decltype(events->events)::const_iterator event;
-    static float wallEndTime;
-    static float wallEnergyLoss;
+    // wall energy loss is taken from the precalculated curve as time passes
+    static float wallDrain;
+    static bool hitWall;
+    // beatmap notes bound to replay note indices on map start, and the spawned controller for each replay note
+    static std::unordered_map<NoteData*, int> bindings;
+    static std::vector<NoteController*> controllers;
+    // spawned notes without a binding, only searched if an event has no bound controller
+    static std::set<NoteController*, NoteComparer> unbound;
 
     static void RunNoteEvent(Replay::Events::Note const& noteEvent, NoteController* controller) {
         static auto sendCut = il2cpp_utils::FindMethodUnsafe(classof(NoteController*), "SendNoteWasCutEvent", 1);
@@ -129,17 +126,84 @@ namespace Events {
         }
     }
 
-    static void ProcessNoteEvent(Replay::Events::Note const& noteEvent) {
-        auto& info = noteEvent.info;
+    static void Bind(IReadonlyBeatmapData* beatmapData) {
+        using Key = std::tuple<int, int, int, int>;
+        // beatmap notes by position, color, and direction, in time order, with the index of the first one that could still be bound
+        std::map<Key, std::pair<int, std::vector<NoteData*>>> candidates;
+
+        auto list = beatmapData->allBeatmapDataItems;
+        auto item = list->head;
+        while (item) {
+            auto data = il2cpp_utils::try_cast<NoteData>(item->item).value_or(nullptr);
+            if (data && (data->scoringType > NoteData::ScoringType::NoScore || data->gameplayType == NoteData::GameplayType::Bomb)) {
+                Key key = {data->lineIndex, (int) data->noteLineLayer, (int) data->colorType, (int) data->cutDirection};
+                candidates[key].second.emplace_back(data);
+            }
+            item = item->next;
+            if (item == list->head)
+                break;
+        }
 
-        for (auto iter = notes.begin(); iter != notes.end(); iter++) {
+        // bind in the same order the events will be run, each to the earliest matching note that would still be spawned
+        for (auto const& reference : events->events) {
+            if (reference.eventType != Replay::Events::Reference::Note)
+                continue;
+            auto const& note = events->notes[reference.index];
+            auto found = candidates.find({note.info.lineIndex, note.info.lineLayer, note.info.colorType, note.info.cutDirection});
+            if (found == candidates.end())
+                continue;
+            auto& [first, datas] = found->second;
+            while (first < datas.size() && (!datas[first] || datas[first]->time < note.time - bindWindow))
+                first++;
+            for (int i = first; i < datas.size(); i++) {
+                if (!datas[i])
+                    continue;
+                if (datas[i]->time > note.time + bindWindow)
+                    break;
+                if (Utils::Matches(datas[i], note.info)) {
+                    bindings[datas[i]] = reference.index;
+                    datas[i] = nullptr;
+                    break;
+                }
+            }
+        }
+    }
+
+    static void Attach(NoteController* controller) {
+        auto binding = bindings.find(controller->noteData);
+        if (binding != bindings.end())
+            controllers[binding->second] = controller;
+        else
+            unbound.insert(controller);
+    }
+
+    static void Detach(NoteController* controller) {
+        unbound.erase(controller);
+        auto binding = bindings.find(controller->noteData);
+        if (binding != bindings.end() && controllers[binding->second] == controller)
+            controllers[binding->second] = nullptr;
+    }
+
+    static void ProcessNoteEvent(int index) {
+        auto const& noteEvent = events->notes[index];
+
+        if (index < controllers.size() && controllers[index]) {
+            auto controller = controllers[index];
+            // clear first, since the note may despawn during the event
+            controllers[index] = nullptr;
+            RunNoteEvent(noteEvent, controller);
+            return;
+        }
+
+        auto& info = noteEvent.info;
+        for (auto iter = unbound.begin(); iter != unbound.end(); iter++) {
             auto controller = *iter;
             auto data = controller->noteData;
             if (!Utils::Matches(data, info))
                 continue;
             RunNoteEvent(noteEvent, controller);
             if (info.eventType == Replay::Events::NoteInfo::Type::MISS)
-                notes.erase(iter);  // note will despawn and be removed in the other cases
+                unbound.erase(iter);  // note will despawn and be removed in the other cases
             return;
         }
         logger.error("Could not find note for event! time: {}, bsor id: {}", noteEvent.time, Utils::BSORNoteID(noteEvent.info));
@@ -149,9 +213,7 @@ namespace Events {
         auto obstacles = MetaCore::Internals::gameEnergyCounter->_playerHeadAndObstacleInteraction;
         obstacles->headDidEnterObstacleEvent->Invoke(nullptr);
         obstacles->headDidEnterObstaclesEvent->Invoke();
-        float diffStartTime = std::max(wallEndTime, wallEvent.time);
-        wallEndTime = std::max(wallEndTime, wallEvent.endTime);
-        wallEnergyLoss += (wallEndTime - diffStartTime) * 1.3;
+        hitWall = true;
     }
 
     static void UpdateTime(float time) {
@@ -160,7 +222,7 @@ namespace Events {
         while (event != events->events.end() && event->time < time) {
             switch (event->eventType) {
                 case Replay::Events::Reference::Note:
-                    ProcessNoteEvent(events->notes[event->index]);
+                    ProcessNoteEvent(event->index);
                     break;
                 case Replay::Events::Reference::Wall:
                     ProcessWallEvent(events->walls[event->index]);
@@ -176,26 +238,24 @@ namespace Events {
         if (!events)
             return;
         event = events->events.lower_bound(time);
+        wallDrain = Utils::SampleEnergy(events->energy, time).wallDrain;
+        hitWall = false;
     }
 
     static void ProcessEnergy(GameEnergyCounter* counter) {
         if (!events)
             return;
-        if (wallEnergyLoss != 0) {
-            bool battery = counter->energyType == GameplayModifiers::EnergyType::Battery;
-            float gameEnergyLoss = UnityEngine::Time::get_deltaTime() * 1.3;
-
-            if (battery) {
+        if (counter->energyType == GameplayModifiers::EnergyType::Battery) {
+            if (hitWall)
                 counter->ProcessEnergyChange(-1);
-                wallEnergyLoss = 0;
-            } else if (gameEnergyLoss >= wallEnergyLoss) {
-                counter->ProcessEnergyChange(-wallEnergyLoss);
-                wallEnergyLoss = 0;
-            } else {
-                counter->ProcessEnergyChange(-gameEnergyLoss);
-                wallEnergyLoss -= gameEnergyLoss;
+        } else {
+            float drain = Utils::SampleEnergy(events->energy, MetaCore::Stats::GetSongTime()).wallDrain;
+            if (drain > wallDrain) {
+                counter->ProcessEnergyChange(wallDrain - drain);
+                wallDrain = drain;
             }
         }
+        hitWall = false;
         if (counter->_nextFrameEnergyChange != 0) {
             counter->ProcessEnergyChange(counter->_nextFrameEnergyChange);
             counter->_nextFrameEnergyChange = 0;
@@ -210,18 +270,7 @@ static Replay::Transform Lerp(Replay::Transform const& start, Replay::Transform
     return {Vector3::Lerp(start.position, end.position, t), Quaternion::Lerp(start.rotation, end.rotation, t)};
 }
 
-static Replay::Pose GetInterpolatedPose(std::vector<Replay::Pose> const& poses, float time) {
-    if (index == 0)
-        return poses.front();
-    if (index >= poses.size())
-        return poses.back();
-
-    int prevIndex = index - 1;
-    while (prevIndex > 0 && poses[prevIndex].time > time)
-        prevIndex--;
-    auto const& prev = poses[prevIndex];
-    auto const& next = poses[index];
-
+static Replay::Pose Lerp(Replay::Pose const& prev, Replay::Pose const& next, float time) {
     float poseDuration = next.time - prev.time;
     if (poseDuration == 0)
         return prev;
@@ -236,6 +285,117 @@ static Replay::Pose GetInterpolatedPose(std::vector<Replay::Pose> const& poses,
     };
 }
 
+template <class T>
+static Replay::Pose GetInterpolatedPose(T& poses, int index, float time) {
+    if (index == 0)
+        return poses.front();
+    if (index >= poses.size())
+        return poses.back();
+
+    int prevIndex = index - 1;
+    while (prevIndex > 0 && poses[prevIndex].time > time)
+        prevIndex--;
+    return Lerp(poses[prevIndex], poses[index], time);
+}
+
+static Replay::Pose UpdatePose(Replay::Data& replay, int& index, float time) {
+    if (!replay.poseStream) {
+        auto& poses = replay.poses;
+        while (index < poses.size() && poses[index].time < time)
+            index++;
+        return GetInterpolatedPose(poses, index, time);
+    }
+    auto& stream = *replay.poseStream;
+    // hold the chunk's first pose while a seek is loading, unless every frame has to be exact
+    if (!stream.IsResident(index) && !Manager::Rendering())
+        return stream.Keyframe(time);
+    while (index < stream.size() && stream[index].time < time)
+        index++;
+    return GetInterpolatedPose(stream, index, time);
+}
+
+static Replay::Pose SeekPose(Replay::Data& replay, int& index, float time) {
+    if (!replay.poseStream) {
+        auto& poses = replay.poses;
+        index = std::distance(poses.begin(), std::lower_bound(poses.begin(), poses.end(), time, Replay::TimeSearcher<Replay::Pose>()));
+        return GetInterpolatedPose(poses, index, time);
+    }
+    // start from the beginning of the chunk so the file is only read in the background
+    auto& stream = *replay.poseStream;
+    index = stream.ChunkStart(time);
+    stream.Prefetch(index);
+    return UpdatePose(replay, index, time);
+}
+
+// calls back with poses at a fixed rate from the first pose until the last
+template <class T, class F>
+static void ForEachSample(T& poses, float rate, F&& callback) {
+    float start = poses.front().time;
+    float end = poses.back().time;
+    int index = 0;
+    for (int slot = 0;; slot++) {
+        float time = start + slot / rate;
+        if (time >= end) {
+            Replay::Pose last = poses.back();
+            last.time = time;
+            callback(last);
+            break;
+        }
+        while (index < poses.size() && poses[index].time < time)
+            index++;
+        callback(GetInterpolatedPose(poses, index, time));
+    }
+}
+
+static bool HasPoses(Replay::Data const& replay) {
+    return replay.poseStream || !replay.poses.empty();
+}
+
+namespace Poses {
+    // the pose track resampled to a fixed rate, so lookups don't depend on the recording's frame times
+    static std::vector<Replay::Pose> resampled;
+    static float start;
+    static float rate;
+
+    static void Resample(std::vector<Replay::Pose> const& poses, float newRate) {
+        resampled.clear();
+        if (poses.empty() || newRate <= 0)
+            return;
+        start = poses.front().time;
+        rate = newRate;
+        resampled.reserve((poses.back().time - start) * rate + 2);
+        ForEachSample(poses, rate, [](Replay::Pose const& pose) { resampled.emplace_back(pose); });
+        logger.debug("resampled {} poses to {} at {} fps", poses.size(), resampled.size(), rate);
+    }
+
+    static Replay::Pose Sample(float time) {
+        float slot = (time - start) * rate;
+        if (slot <= 0)
+            return resampled.front();
+        int prev = slot;
+        if (prev >= resampled.size() - 1)
+            return resampled.back();
+        return Lerp(resampled[prev], resampled[prev + 1], time);
+    }
+}
+
+namespace Ghosts {
+    // extra replays that only drive avatar poses, with cursor state kept in parallel arrays
+    static std::vector<std::shared_ptr<Replay::Data>> replays;
+    static std::vector<int> indices;
+    static std::vector<Replay::Pose> poses;
+
+    static void UpdateTime(float time) {
+        for (int i = 0; i < replays.size(); i++)
+            poses[i] = UpdatePose(*replays[i], indices[i], time);
+    }
+
+    static void SeekTo(float time) {
+        for (int i = 0; i < replays.size(); i++)
+            poses[i] = SeekPose(*replays[i], indices[i], time);
+    }
+}
+
 void Playback::UpdateTime() {
     if (!Manager::Replaying())
         return;
@@ -243,16 +403,18 @@ void Playback::UpdateTime() {
     float time = MetaCore::Stats::GetSongTime();
     Frames::UpdateTime(time);
     Events::UpdateTime(time);
+    Ghosts::UpdateTime(time);
 
     auto& info = Manager::GetCurrentInfo();
     if (info.quit && time > info.quitTime)
         UnityEngine::Object::FindObjectOfType<PauseController*>()->HandlePauseMenuManagerDidPressMenuButton();
 
-    auto& poses = Manager::GetCurrentReplay().poses;
+    if (!Poses::resampled.empty()) {
+        interpolatedPose = Poses::Sample(time);
+        return;
+    }
 
-    while (index < poses.size() && poses[index].time < time)
-        index++;
-    interpolatedPose = GetInterpolatedPose(poses, time);
+    interpolatedPose = UpdatePose(Manager::GetCurrentReplay(), index, time);
 }
 
 void Playback::SeekTo(float time) {
@@ -261,16 +423,46 @@ void Playback::SeekTo(float time) {
 
     Frames::SeekTo(time);
     Events::SeekTo(time);
+    Ghosts::SeekTo(time);
 
-    auto& poses = Manager::GetCurrentReplay().poses;
-    index = std::distance(poses.begin(), std::lower_bound(poses.begin(), poses.end(), time, Replay::TimeSearcher<Replay::Pose>()));
-    interpolatedPose = GetInterpolatedPose(poses, time);
+    if (!Poses::resampled.empty()) {
+        interpolatedPose = Poses::Sample(time);
+        return;
+    }
+
+    interpolatedPose = SeekPose(Manager::GetCurrentReplay(), index, time);
 }
 
 Replay::Pose const& Playback::GetPose() {
     return interpolatedPose;
 }
 
+void Playback::SetGhosts(std::vector<std::shared_ptr<Replay::Data>> ghosts) {
+    std::erase_if(ghosts, [](auto const& ghost) { return !ghost || !HasPoses(*ghost); });
+    Ghosts::replays = std::move(ghosts);
+    Ghosts::indices.assign(Ghosts::replays.size(), 0);
+    Ghosts::poses.resize(Ghosts::replays.size());
+    logger.debug("set {} ghost replays", Ghosts::replays.size());
+}
+
+void Playback::SamplePoses(Replay::Data const& replay, float rate, std::function<void(Replay::Pose const&)> const& callback) {
+    if (!HasPoses(replay) || rate <= 0)
+        return;
+    if (replay.poseStream) {
+        Replay::PoseStream::Reader reader(replay.poseStream);
+        ForEachSample(reader, rate, callback);
+    } else
+        ForEachSample(replay.poses, rate, callback);
+}
+
+int Playback::GetGhostCount() {
+    return Ghosts::replays.size();
+}
+
+Replay::Pose const& Playback::GetGhostPose(int ghost) {
+    return Ghosts::poses[ghost];
+}
+
 bool Playback::DisableRealEvent(bool bad) {
     if (!Manager::Replaying())
         return false;
@@ -285,17 +477,33 @@ bool Playback::DisableListSorting() {
     return Manager::Replaying() && Events::events;
 }
 
+void Playback::BindNotes(IReadonlyBeatmapData* beatmapData) {
+    Events::bindings.clear();
+    if (!Manager::Replaying() || !Events::events)
+        return;
+
+    Events::controllers.assign(Events::events->notes.size(), nullptr);
+    Events::Bind(beatmapData);
+    logger.debug("bound {} of {} note events", Events::bindings.size(), Events::events->notes.size());
+
+    // attach any notes that spawned before the bindings were created
+    auto spawned = std::move(Events::unbound);
+    Events::unbound.clear();
+    for (auto note : spawned)
+        Events::Attach(note);
+}
+
 void Playback::AddNoteController(NoteController* note) {
     if (!Manager::Replaying())
         return;
     auto data = note->noteData;
     if (data->scoringType > NoteData::ScoringType::NoScore || data->gameplayType == NoteData::GameplayType::Bomb)
-        Events::notes.insert(note);
+        Events::Attach(note);
 }
 
 void Playback::RemoveNoteController(NoteController* note) {
     if (Manager::Replaying())
-        Events::notes.erase(note);
+        Events::Detach(note);
 }
 
 static GameplayModifiers* CreateModifiers() {
@@ -345,9 +553,11 @@ static PracticeSettings* CreatePracticeSettings() {
 }
 
 void Playback::ProcessStart(GameplayModifiers*& modifiers, PracticeSettings*& practice, PlayerSpecificSettings* player) {
-    Events::notes.clear();
-    Events::wallEndTime = 0;
-    Events::wallEnergyLoss = 0;
+    Events::bindings.clear();
+    Events::controllers.clear();
+    Events::unbound.clear();
+    Events::wallDrain = 0;
+    Events::hitWall = false;
 
     Frames::lastCutTime = -9999;
 
@@ -364,8 +574,14 @@ void Playback::ProcessStart(GameplayModifiers*& modifiers, PracticeSettings*& pr
     if (Frames::frames)
         Frames::score = Frames::frames->scores.begin();
 
-    interpolatedPose = replay.poses.front();
-    index = 0;
+    interpolatedPose = SeekPose(replay, index, 0);
+    Ghosts::SeekTo(0);
+
+    // streamed poses aren't all in memory to be resampled
+    if (Manager::Rendering() && getConfig().ResamplePoses.GetValue() && !replay.poseStream)
+        Poses::Resample(replay.poses, getConfig().FPS.GetValue());
+    else
+        Poses::resampled.clear();
 
     modifiers = CreateModifiers();
     practice = CreatePracticeSettings();
@@ -0,0 +1,152 @@
+#include "poses.hpp"
+
+using namespace Replay;
+
+PoseStream::PoseStream(std::string path, std::streamoff offset, std::vector<Pose> const& poses) :
+    path(std::move(path)),
+    offset(offset),
+    count(poses.size()),
+    last(poses.back()) {
+    keyframes.reserve(count / ChunkPoses + 1);
+    for (int i = 0; i < count; i += ChunkPoses)
+        keyframes.emplace_back(poses[i]);
+}
+
+PoseStream::~PoseStream() {
+    {
+        std::unique_lock lock(mutex);
+        stop = true;
+    }
+    condition.notify_all();
+    if (thread.joinable())
+        thread.join();
+}
+
+Pose PoseStream::operator[](int index) {
+    int chunk = index / ChunkPoses;
+    if (chunk == previousIndex && chunk != currentIndex)
+        return (*previous)[index - chunk * ChunkPoses];
+    if (chunk != currentIndex) {
+        if (chunk == currentIndex + 1) {
+            previous = current;
+            previousIndex = currentIndex;
+        } else {
+            previous = nullptr;
+            previousIndex = -1;
+        }
+        current = nullptr;
+        {
+            std::unique_lock lock(mutex);
+            auto found = chunks.find(chunk);
+            if (found != chunks.end())
+                current = found->second;
+        }
+        if (!current) {
+            logger.debug("pose chunk {} was not prefetched", chunk);
+            current = Read(chunk, input);
+            std::unique_lock lock(mutex);
+            chunks[chunk] = current;
+        }
+        currentIndex = chunk;
+        Prefetch(index);
+    }
+    return (*current)[index - chunk * ChunkPoses];
+}
+
+bool PoseStream::IsResident(int index) {
+    int chunk = std::clamp(index, 0, count - 1) / ChunkPoses;
+    if (chunk == currentIndex)
+        return true;
+    std::unique_lock lock(mutex);
+    return chunks.contains(chunk);
+}
+
+int PoseStream::ChunkStart(float time) const {
+    auto keyframe = std::upper_bound(keyframes.begin(), keyframes.end(), time, TimeSearcher<Pose>());
+    if (keyframe != keyframes.begin())
+        keyframe--;
+    return std::distance(keyframes.begin(), keyframe) * ChunkPoses;
+}
+
+Pose const& PoseStream::Keyframe(float time) const {
+    return keyframes[ChunkStart(time) / ChunkPoses];
+}
+
+void PoseStream::Prefetch(int index) {
+    int chunk = std::clamp(index, 0, count - 1) / ChunkPoses;
+    {
+        std::unique_lock lock(mutex);
+        // keep one chunk behind so interpolation across the boundary doesn't evict the one ahead
+        window = chunk;
+        std::erase_if(chunks, [chunk](auto const& pair) { return pair.first < chunk - 1 || pair.first > chunk + 2; });
+        requested.clear();
+        for (int i = chunk; i <= chunk + 1 && i * ChunkPoses < count; i++) {
+            if (!chunks.contains(i))
+                requested.emplace(i);
+        }
+        if (requested.empty())
+            return;
+        if (!thread.joinable())
+            thread = std::thread(&PoseStream::Work, this);
+    }
+    condition.notify_one();
+}
+
+Pose PoseStream::Reader::operator[](int index) {
+    int chunk = index / ChunkPoses;
+    if (chunk != currentIndex) {
+        current = stream->Read(chunk, input);
+        currentIndex = chunk;
+    }
+    return (*current)[index - chunk * ChunkPoses];
+}
+
+std::vector<Pose> PoseStream::ReadAll() const {
+    std::vector<Pose> ret(count);
+    std::ifstream input(path, std::ios::binary);
+    input.seekg(offset);
+    input.read(reinterpret_cast<char*>(ret.data()), count * sizeof(Pose));
+    if (!input)
+        throw std::runtime_error(fmt::format("failed to read poses from {}", path));
+    return ret;
+}
+
+PoseStream::Chunk PoseStream::Read(int chunk, std::ifstream& input) const {
+    int start = chunk * ChunkPoses;
+    int size = std::min(ChunkPoses, count - start);
+    auto ret = std::make_shared<std::vector<Pose>>(size, keyframes[chunk]);
+
+    if (!input.is_open())
+        input.open(path, std::ios::binary);
+    input.clear();
+    input.seekg(offset + (std::streamoff) start * sizeof(Pose));
+    input.read(reinterpret_cast<char*>(ret->data()), size * sizeof(Pose));
+    if (!input) {
+        // hold the chunk's first pose instead of failing in the middle of playback
+        logger.error("failed to read pose chunk {} from {}", chunk, path);
+        std::fill(ret->begin(), ret->end(), keyframes[chunk]);
+    }
+    return ret;
+}
+
+void PoseStream::Work() {
+    std::ifstream workerInput;
+    while (true) {
+        int chunk;
+        {
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [this]() { return stop || !requested.empty(); });
+            if (stop)
+                return;
+            chunk = *requested.begin();
+            requested.erase(requested.begin());
+            if (chunks.contains(chunk))
+                continue;
+        }
+        auto data = Read(chunk, workerInput);
+        std::unique_lock lock(mutex);
+        // the window may have moved while reading
+        if (chunk >= window - 1 && chunk <= window + 2)
+            chunks.emplace(chunk, std::move(data));
+    }
+}
@@ -0,0 +1,146 @@
+#include "queue.hpp"
+
+#include <unordered_map>
+
+#include "main.hpp"
+#include "persist.hpp"
+
+static std::string const& GetJournalPath() {
+    static auto path = getDataDir(MOD_ID) + "queue.journal";
+    return path;
+}
+
+// the journal is compacted on load once it has this many more lines than entries
+static constexpr int CompactLines = 256;
+
+static std::vector<LevelSelection> levels;
+// counts of entries by what identifies them as the same render, for membership checks
+static std::unordered_map<std::string, int> counts;
+
+static std::string GetKey(LevelSelection const& level) {
+    return fmt::format("{}|{}|{}|{}", level.ID, level.Characteristic, level.Difficulty, level.ReplayHash);
+}
+
+static void Index(LevelSelection const& level, int change) {
+    auto key = GetKey(level);
+    if ((counts[key] += change) <= 0)
+        counts.erase(key);
+}
+
+static void Append(std::string const& line) {
+    std::ofstream output(GetJournalPath(), std::ios::app);
+    output << line << "\n";
+    if (!output)
+        logger.error("failed to write render queue journal");
+}
+
+static void Rewrite() {
+    std::string contents;
+    for (auto const& level : levels)
+        contents += fmt::format("+ {}\n", WriteToString(level));
+    Persist::WriteFile(GetJournalPath(), contents);
+}
+
+// "+ <json>" adds an entry to the end, "- <index>" removes one, and "c" clears the queue
+static bool Apply(std::string const& line) {
+    if (line == "c") {
+        levels.clear();
+        counts.clear();
+        return true;
+    }
+    if (line.size() < 3 || line[1] != ' ')
+        return false;
+    auto value = line.substr(2);
+    try {
+        if (line[0] == '+') {
+            Index(levels.emplace_back(ReadFromString<LevelSelection>(value)), 1);
+            return true;
+        }
+        if (line[0] == '-') {
+            int index = std::stoi(value);
+            if (index < 0 || index >= levels.size())
+                return false;
+            Index(levels[index], -1);
+            levels.erase(levels.begin() + index);
+            return true;
+        }
+    } catch (std::exception const& e) {
+        logger.error("failed to read render queue journal line: {}", e.what());
+    }
+    return false;
+}
+
+void Queue::Load() {
+    levels.clear();
+    counts.clear();
+    if (!direxists(getDataDir(MOD_ID)))
+        mkpath(getDataDir(MOD_ID));
+
+    if (!fileexists(GetJournalPath())) {
+        auto old = getConfig().RenderQueue.GetValue();
+        if (old.empty())
+            return;
+        logger.info("Moving {} queued renders from the config", old.size());
+        levels = std::move(old);
+        for (auto const& level : levels)
+            Index(level, 1);
+        Rewrite();
+        getConfig().RenderQueue.SetValue({});
+        return;
+    }
+
+    std::ifstream input(GetJournalPath());
+    std::string line;
+    int lines = 0;
+    while (std::getline(input, line)) {
+        // a line without its newline was cut off by a crash
+        if (input.eof())
+            break;
+        if (!Apply(line))
+            logger.warn("skipping render queue journal line {}", lines + 1);
+        lines++;
+    }
+    logger.debug("loaded {} queued renders from {} journal lines", levels.size(), lines);
+
+    if (lines - (int) levels.size() > CompactLines)
+        Rewrite();
+}
+
+std::vector<LevelSelection> const& Queue::Get() {
+    return levels;
+}
+
+bool Queue::Empty() {
+    return levels.empty();
+}
+
+bool Queue::Contains(LevelSelection const& level) {
+    return counts.contains(GetKey(level));
+}
+
+void Queue::Add(LevelSelection const& level) {
+    Index(levels.emplace_back(level), 1);
+    Append(fmt::format("+ {}", WriteToString(level)));
+}
+
+void Queue::Remove(int index) {
+    if (index < 0 || index >= levels.size())
+        return;
+    Index(levels[index], -1);
+    levels.erase(levels.begin() + index);
+    Append(fmt::format("- {}", index));
+}
+
+void Queue::Clear() {
+    levels.clear();
+    counts.clear();
+    Append("c");
+}
+
+void Queue::Replace(std::vector<LevelSelection> newLevels) {
+    levels = std::move(newLevels);
+    counts.clear();
+    for (auto const& level : levels)
+        Index(level, 1);
+    Rewrite();
+}
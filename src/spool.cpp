@@ -0,0 +1,99 @@
+#include "spool.hpp"
+
+#include <set>
+
+#include "main.hpp"
+#include "parsing.hpp"
+
+static std::string const& GetSpoolPath() {
+    static auto path = getDataDir(MOD_ID) + "spool/";
+    return path;
+}
+
+static std::string const Extension = ".bsor";
+
+// the copy keeps the original file name, since bsor files store some of their info there
+static std::optional<std::filesystem::path> GetFile(std::string const& hash) {
+    std::filesystem::path directory = GetSpoolPath() + hash;
+    if (!std::filesystem::is_directory(directory))
+        return std::nullopt;
+    for (auto const& entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == Extension)
+            return entry.path();
+    }
+    return std::nullopt;
+}
+
+bool Spool::Add(std::string const& hash, std::string const& path) {
+    // only bsors can be read back, so other formats stay in memory
+    if (path.empty() || std::filesystem::path(path).extension() != Extension || !fileexists(path))
+        return false;
+    try {
+        if (GetFile(hash))
+            return true;
+        auto directory = std::filesystem::path(GetSpoolPath() + hash);
+        std::filesystem::create_directories(directory);
+        auto file = directory / std::filesystem::path(path).filename();
+        auto temp = file;
+        temp += ".tmp";
+        // renamed into place so a cut off copy is never mistaken for the replay
+        std::filesystem::copy_file(path, temp, std::filesystem::copy_options::overwrite_existing);
+        std::filesystem::rename(temp, file);
+        logger.debug("spooled temporary replay {} to {}", hash, file.string());
+        return true;
+    } catch (std::exception const& e) {
+        logger.error("failed to spool temporary replay {}: {}", path, e.what());
+        return false;
+    }
+}
+
+bool Spool::Contains(std::string const& hash) {
+    try {
+        return GetFile(hash).has_value();
+    } catch (std::exception const& e) {
+        logger.error("failed to find spooled replay {}: {}", hash, e.what());
+        return false;
+    }
+}
+
+std::string Spool::GetPath(std::string const& hash) {
+    try {
+        if (auto file = GetFile(hash))
+            return file->string();
+    } catch (std::exception const& e) {
+        logger.error("failed to find spooled replay {}: {}", hash, e.what());
+    }
+    return "";
+}
+
+std::shared_ptr<Replay::Data> Spool::Load(std::string const& hash) {
+    try {
+        auto file = GetFile(hash);
+        if (!file) {
+            logger.error("no spooled replay for {}", hash);
+            return nullptr;
+        }
+        return Parsing::ReadBSOR(file->string());
+    } catch (std::exception const& e) {
+        logger.error("failed to read spooled replay {}: {}", hash, e.what());
+        return nullptr;
+    }
+}
+
+void Spool::Prune(std::vector<LevelSelection> const& levels) {
+    if (!direxists(GetSpoolPath()))
+        return;
+    std::set<std::string> used;
+    for (auto const& level : levels) {
+        if (level.Temporary)
+            used.emplace(level.ReplayHash);
+    }
+    try {
+        for (auto const& entry : std::filesystem::directory_iterator(GetSpoolPath())) {
+            if (!used.contains(entry.path().filename().string()))
+                std::filesystem::remove_all(entry.path());
+        }
+    } catch (std::exception const& e) {
+        logger.error("failed to prune replay spool: {}", e.what());
+    }
+}
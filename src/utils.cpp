@@ -266,6 +266,17 @@ static float AccuracyForDistance(float distance) {
     return 1 - std::clamp(distance / (float) 0.3, (float) 0, (float) 1);
 }
 
+Replay::Events::EnergyPoint Utils::SampleEnergy(std::vector<Replay::Events::EnergyPoint> const& curve, float time) {
+    auto next = std::upper_bound(curve.begin(), curve.end(), time, Replay::TimeSearcher<Replay::Events::EnergyPoint>());
+    if (next == curve.begin())
+        return {time, curve.front().energy, curve.front().wallDrain};
+    auto prev = std::prev(next);
+    if (next == curve.end() || next->time == prev->time)
+        return {time, prev->energy, prev->wallDrain};
+    float t = (time - prev->time) / (next->time - prev->time);
+    return {time, std::lerp(prev->energy, next->energy, t), std::lerp(prev->wallDrain, next->wallDrain, t)};
+}
+
 std::array<int, 4> Utils::ScoreForNote(Replay::Events::Note const& note, bool max) {
     bool goodCut = note.info.eventType == Replay::Events::NoteInfo::Type::GOOD;
     if (!goodCut && !max)
@@ -317,15 +328,6 @@ static bool ScoringTypeMatches(int replayType, GlobalNamespace::NoteData::Scorin
     }
 }
 
-static int BSORNoteID(GlobalNamespace::NoteData* note) {
-    int colorType = (int) note->colorType;
-    if (colorType < 0)
-        colorType = 3;
-
-    return ((int) note->scoringType + 2) * 10000 + note->lineIndex * 1000 + (int) note->noteLineLayer * 100 + colorType * 10 +
-           (int) note->cutDirection;
-}
-
 int Utils::BSORNoteID(Replay::Events::NoteInfo const& note) {
     int colorType = note.colorType;
     if (colorType < 0)
@@ -333,15 +335,29 @@ int Utils::BSORNoteID(Replay::Events::NoteInfo const& note) {
     return (note.scoringType + 2) * 10000 + note.lineIndex * 1000 + note.lineLayer * 100 + colorType * 10 + note.cutDirection;
 }
 
-bool Utils::Matches(GlobalNamespace::NoteData* data, Replay::Events::NoteInfo const& info, bool oldScoringTypes, bool checkME) {
+Replay::Events::NoteInfo Utils::GetNoteInfo(GlobalNamespace::NoteData* data) {
+    return {
+        .scoringType = (short) data->scoringType,
+        .lineIndex = (short) data->lineIndex,
+        .lineLayer = (short) data->noteLineLayer,
+        .colorType = (short) data->colorType,
+        .cutDirection = (short) data->cutDirection,
+    };
+}
+
+bool Utils::Matches(Replay::Events::NoteInfo const& data, Replay::Events::NoteInfo const& info, bool oldScoringTypes, bool checkME) {
     if (checkME) {
         int dataId = BSORNoteID(data);
         int infoId = BSORNoteID(info);
         // I still don't entirely understand this fix, but thankfully I am pretty sure it is only a bug in replays from before scoring types
         return dataId == infoId || dataId == infoId + 30000;
     }
-    return ScoringTypeMatches(info.scoringType, data->scoringType, oldScoringTypes) && (int) data->lineIndex == info.lineIndex &&
-           (int) data->noteLineLayer == info.lineLayer && (int) data->colorType == info.colorType && (int) data->cutDirection == info.cutDirection;
+    return ScoringTypeMatches(info.scoringType, (NoteData::ScoringType) data.scoringType, oldScoringTypes) && data.lineIndex == info.lineIndex &&
+           data.lineLayer == info.lineLayer && data.colorType == info.colorType && data.cutDirection == info.cutDirection;
+}
+
+bool Utils::Matches(GlobalNamespace::NoteData* data, Replay::Events::NoteInfo const& info, bool oldScoringTypes, bool checkME) {
+    return Matches(GetNoteInfo(data), info, oldScoringTypes, checkME);
 }
 
 static std::vector<OVRInput::Button> const Buttons = {